@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout of a .atlas file written by atlas_packer and read by TextureAtlas.
+// AtlasHeader, then page_count AtlasPages, then entry_count AtlasEntries sorted
+// by name (strcmp), then the RGBA8 pixels of each page at AtlasPage::offset.
+// Pages are stored bottom row first, like stbi with vertical flip, so uvs map directly.
+
+static const uint32_t ATLAS_MAGIC = 0x534c5441; // "ATLS"
+static const uint32_t ATLAS_VERSION = 1;
+
+struct AtlasHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t page_count;
+    uint32_t entry_count;
+};
+
+struct AtlasPage
+{
+    uint32_t width, height;
+    uint64_t offset; // from the start of the file
+};
+
+struct AtlasEntry
+{
+    char name[56]; // file name without directory, NUL terminated
+    uint32_t page;
+    uint16_t x, y, width, height; // image pixels inside the page, without gutter
+    float u0, v0, u1, v1;
+};
@@ -0,0 +1,301 @@
+// Offline tool: packs images into RGBA8 atlas pages and writes a .atlas file
+// (see atlas_format.h) that TextureAtlas loads at runtime.
+//
+//   atlas_packer [--page-size N] [--padding N] <output.atlas> <image or directory>...
+//
+// Packing is skyline bottom-left with images sorted tallest first. Every image
+// gets a gutter of `padding` pixels filled by extruding its edge pixels, and
+// placements are aligned to 4 pixels, so filtering and the first few mip
+// levels never sample a neighbour.
+
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "atlas_format.h"
+
+struct Image
+{
+    std::string path;
+    std::string name;
+    int width, height;
+    uint8_t *pixels; // RGBA8, bottom row first
+    uint32_t page;
+    int x, y; // of the padded rect
+};
+
+struct SkylineSegment
+{
+    int x, y, width;
+};
+
+struct Page
+{
+    int width, height;
+    int used_height = 0;
+    std::vector<SkylineSegment> skyline;
+
+    // Lowest y at which a w wide rect can sit with its left edge on segment i, or -1
+    int fit(size_t i, int w, int h) const
+    {
+        int x = skyline[i].x;
+        if (x + w > width)
+            return -1;
+        int y = 0;
+        int remaining = w;
+        for (size_t j = i; remaining > 0; j++)
+        {
+            if (j >= skyline.size())
+                return -1;
+            y = std::max(y, skyline[j].y);
+            remaining -= skyline[j].width;
+        }
+        return y + h <= height ? y : -1;
+    }
+
+    bool insert(int w, int h, int *out_x, int *out_y)
+    {
+        int best_index = -1, best_x = 0, best_y = 0;
+        for (size_t i = 0; i < skyline.size(); i++)
+        {
+            int y = fit(i, w, h);
+            if (y >= 0 && (best_index < 0 || y < best_y || (y == best_y && skyline[i].x < best_x)))
+            {
+                best_index = (int)i;
+                best_x = skyline[i].x;
+                best_y = y;
+            }
+        }
+        if (best_index < 0)
+            return false;
+
+        // Raise the skyline under the new rect
+        skyline.insert(skyline.begin() + best_index, {best_x, best_y + h, w});
+        for (size_t i = best_index + 1; i < skyline.size();)
+        {
+            SkylineSegment &segment = skyline[i];
+            int covered = best_x + w - segment.x;
+            if (covered <= 0)
+                break;
+            if (covered < segment.width)
+            {
+                segment.x += covered;
+                segment.width -= covered;
+                break;
+            }
+            skyline.erase(skyline.begin() + i);
+        }
+        for (size_t i = 0; i + 1 < skyline.size();)
+        {
+            if (skyline[i].y == skyline[i + 1].y)
+            {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        used_height = std::max(used_height, best_y + h);
+        *out_x = best_x;
+        *out_y = best_y;
+        return true;
+    }
+};
+
+static int align4(int value)
+{
+    return (value + 3) & ~3;
+}
+
+static bool is_image_file(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    return ext && (!strcasecmp(ext, ".png") || !strcasecmp(ext, ".jpg") || !strcasecmp(ext, ".jpeg") ||
+                   !strcasecmp(ext, ".tga") || !strcasecmp(ext, ".bmp"));
+}
+
+static void collect_inputs(const char *path, std::vector<std::string> &files)
+{
+    DIR *dir = opendir(path);
+    if (!dir)
+    {
+        files.push_back(path);
+        return;
+    }
+    std::vector<std::string> names;
+    while (dirent *entry = readdir(dir))
+        if (entry->d_name[0] != '.' && is_image_file(entry->d_name))
+            names.push_back(entry->d_name);
+    closedir(dir);
+    std::sort(names.begin(), names.end()); // deterministic output
+    for (auto &name : names)
+        files.push_back(std::string(path) + "/" + name);
+}
+
+int main(int argc, char **argv)
+{
+    int page_size = 4096;
+    int padding = 8;
+    const char *output = NULL;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--page-size") && i + 1 < argc)
+            page_size = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--padding") && i + 1 < argc)
+            padding = atoi(argv[++i]);
+        else if (!output)
+            output = argv[i];
+        else
+            collect_inputs(argv[i], files);
+    }
+    if (!output || files.empty())
+    {
+        fprintf(stderr, "usage: %s [--page-size N] [--padding N] <output.atlas> <image or directory>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    stbi_set_flip_vertically_on_load(true);
+    std::vector<Image> images;
+    for (auto &file : files)
+    {
+        Image image = {.path = file};
+        int channels;
+        image.pixels = stbi_load(file.c_str(), &image.width, &image.height, &channels, 4);
+        if (!image.pixels)
+        {
+            fprintf(stderr, "[%s:%d] Unable to load %s: %s\n", __FILE__, __LINE__, file.c_str(), stbi_failure_reason());
+            return EXIT_FAILURE;
+        }
+        size_t slash = file.find_last_of('/');
+        image.name = slash == std::string::npos ? file : file.substr(slash + 1);
+        if (image.name.size() >= sizeof(AtlasEntry::name))
+        {
+            fprintf(stderr, "[%s:%d] Name too long: %s\n", __FILE__, __LINE__, image.name.c_str());
+            return EXIT_FAILURE;
+        }
+        images.push_back(image);
+    }
+
+    std::vector<Image *> order;
+    for (auto &image : images)
+        order.push_back(&image);
+    std::sort(order.begin(), order.end(), [](const Image *a, const Image *b)
+              { return a->height != b->height ? a->height > b->height : a->name < b->name; });
+
+    std::vector<Page> pages;
+    for (Image *image : order)
+    {
+        int w = align4(image->width + 2 * padding);
+        int h = align4(image->height + 2 * padding);
+        bool placed = false;
+        for (size_t p = 0; p < pages.size() && !placed; p++)
+        {
+            if (pages[p].insert(w, h, &image->x, &image->y))
+            {
+                image->page = (uint32_t)p;
+                placed = true;
+            }
+        }
+        if (!placed)
+        {
+            // Start a new page, sized up for images bigger than page_size
+            Page page = {.width = std::max(page_size, w), .height = std::max(page_size, h)};
+            page.skyline.push_back({0, 0, page.width});
+            page.insert(w, h, &image->x, &image->y);
+            image->page = (uint32_t)pages.size();
+            pages.push_back(page);
+        }
+    }
+
+    // Trim unused rows off the top of each page
+    for (auto &page : pages)
+        page.height = align4(page.used_height);
+
+    AtlasHeader header = {.magic = ATLAS_MAGIC, .version = ATLAS_VERSION,
+                          .page_count = (uint32_t)pages.size(), .entry_count = (uint32_t)images.size()};
+    std::vector<AtlasPage> page_headers(pages.size());
+    uint64_t offset = sizeof(AtlasHeader) + pages.size() * sizeof(AtlasPage) + images.size() * sizeof(AtlasEntry);
+    for (size_t p = 0; p < pages.size(); p++)
+    {
+        page_headers[p] = {(uint32_t)pages[p].width, (uint32_t)pages[p].height, offset};
+        offset += (uint64_t)pages[p].width * pages[p].height * 4;
+    }
+
+    std::vector<AtlasEntry> entries;
+    for (auto &image : images)
+    {
+        const Page &page = pages[image.page];
+        AtlasEntry entry = {};
+        strcpy(entry.name, image.name.c_str());
+        entry.page = image.page;
+        entry.x = (uint16_t)(image.x + padding);
+        entry.y = (uint16_t)(image.y + padding);
+        entry.width = (uint16_t)image.width;
+        entry.height = (uint16_t)image.height;
+        entry.u0 = (float)entry.x / page.width;
+        entry.v0 = (float)entry.y / page.height;
+        entry.u1 = (float)(entry.x + entry.width) / page.width;
+        entry.v1 = (float)(entry.y + entry.height) / page.height;
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const AtlasEntry &a, const AtlasEntry &b)
+              { return strcmp(a.name, b.name) < 0; });
+
+    FILE *file = fopen(output, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "[%s:%d] Unable to write %s\n", __FILE__, __LINE__, output);
+        return EXIT_FAILURE;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(page_headers.data(), sizeof(AtlasPage), page_headers.size(), file);
+    fwrite(entries.data(), sizeof(AtlasEntry), entries.size(), file);
+
+    for (size_t p = 0; p < pages.size(); p++)
+    {
+        const Page &page = pages[p];
+        std::vector<uint8_t> pixels((size_t)page.width * page.height * 4, 0);
+        for (auto &image : images)
+        {
+            if (image.page != p)
+                continue;
+            // Copy the padded rect, clamping to the image edge to extrude it into the gutter
+            int w = align4(image.width + 2 * padding);
+            int h = align4(image.height + 2 * padding);
+            for (int y = 0; y < h; y++)
+            {
+                int sy = std::clamp(y - padding, 0, image.height - 1);
+                for (int x = 0; x < w; x++)
+                {
+                    int sx = std::clamp(x - padding, 0, image.width - 1);
+                    memcpy(&pixels[((size_t)(image.y + y) * page.width + image.x + x) * 4],
+                           &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+                }
+            }
+        }
+        fwrite(pixels.data(), 1, pixels.size(), file);
+        printf("page %zu: %dx%d\n", p, page.width, page.height);
+    }
+
+    if (fclose(file) != 0)
+    {
+        fprintf(stderr, "[%s:%d] Unable to write %s\n", __FILE__, __LINE__, output);
+        return EXIT_FAILURE;
+    }
+    for (auto &image : images)
+        stbi_image_free(image.pixels);
+    printf("packed %zu images into %zu pages: %s\n", images.size(), pages.size(), output);
+    return 0;
+}
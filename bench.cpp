@@ -0,0 +1,401 @@
+#include <GL/glew.h>
+#ifndef __linux__
+#include <GLFW/glfw3.h> // only for the hidden window where there is no EGL
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "gl_call_stats.cpp" // first: reroutes GL 1.1 calls in everything after it
+#include "profiler.cpp"
+#include "gl_state_cache.cpp"
+#include "gpu_profiler.cpp"
+#include "file_data.cpp"
+#include "mpmc_queue.cpp"
+#include "job_system.cpp"
+#include "shader.cpp"
+#include "stream_buffer.cpp"
+#include "sprite_batch.cpp"
+#include "render_commands.cpp"
+#include "headless.cpp"
+
+// Renderer benchmark. Generates a sprite scene from a seed, draws it headless
+// through the same path as main (per-thread recording, RenderQueue,
+// SpriteBatch, StreamBuffer) for a fixed number of frames and prints frame
+// time percentiles, draw calls and upload volume as JSON. The same options
+// give the same workload on every run and machine, so results of two
+// renderer versions can be compared directly.
+//
+//   bench --sprites 100000 --textures 8 --shaders 2 --dynamic 0.25 --overdraw 4 > result.json
+//
+// Runs from bin/ like main, for ../res/shaders.
+
+struct BenchOptions
+{
+    uint32_t sprites = 10000;
+    uint32_t textures = 4;
+    uint32_t shaders = 2;
+    float dynamic = 0.1f;  // fraction of sprites that move every frame
+    float overdraw = 2.0f; // sprite area over screen area
+    uint32_t frames = 300; // measured
+    uint32_t warmup = 30;  // run first, not measured
+    uint32_t seed = 1;
+    const char *output = nullptr; // stdout when null
+};
+
+static const uint32_t RECORD_BATCH = 16384;
+
+// Sprites with random kinds, in no particular order, the first dynamic_count of them moving
+struct BenchScene
+{
+    uint32_t kinds;
+    uint32_t dynamic_count;
+    float size;
+    std::vector<SpriteInstance> sprites;
+    std::vector<uint32_t> kind;
+    std::vector<float> dx, dy; // dynamic sprites only, units per frame
+};
+
+static uint32_t bench_random(uint32_t &state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static float bench_random_float(uint32_t &state, float min, float max)
+{
+    return min + (max - min) * (float)(bench_random(state) >> 8) * (1.0f / (1 << 24));
+}
+
+static void generate_scene(BenchScene &scene, const BenchOptions &options)
+{
+    uint32_t random_state = options.seed ? options.seed : 1;
+    uint32_t count = options.sprites;
+    scene.kinds = options.textures * options.shaders;
+    scene.dynamic_count = (uint32_t)(count * options.dynamic);
+    // n squares of side s cover overdraw times the 2x2 screen
+    scene.size = std::min(2.0f, sqrtf(options.overdraw * 4.0f / std::max(1u, count)));
+    scene.sprites.resize(count);
+    scene.kind.resize(count);
+    scene.dx.resize(scene.dynamic_count);
+    scene.dy.resize(scene.dynamic_count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        SpriteInstance &sprite = scene.sprites[i];
+        float range = 1.0f - scene.size;
+        sprite = {.x = bench_random_float(random_state, -1.0f, range), .y = bench_random_float(random_state, -1.0f, range),
+                  .w = scene.size, .h = scene.size, .uv = {0, 0, 1, 0, 0, 1}};
+        uint32_t color = bench_random(random_state);
+        memcpy(sprite.color, &color, sizeof(sprite.color));
+        sprite.color[3] = 255;
+        scene.kind[i] = bench_random(random_state) % scene.kinds;
+        if (i < scene.dynamic_count)
+        {
+            scene.dx[i] = bench_random_float(random_state, -0.01f, 0.01f);
+            scene.dy[i] = bench_random_float(random_state, -0.01f, 0.01f);
+        }
+    }
+}
+
+struct RecordJob
+{
+    BenchScene *scene;
+    GameRenderList *render_list;
+};
+
+// Moves the dynamic sprites in [begin, end), wrapping at the edges, then
+// records the range with one draw per sprite kind in it
+static void record_sprites(void *data, uint32_t begin, uint32_t end)
+{
+    auto *job = (RecordJob *)data;
+    BenchScene &scene = *job->scene;
+
+    float low = -1.0f, span = 2.0f - scene.size;
+    for (uint32_t i = begin; i < std::min(end, scene.dynamic_count); i++)
+    {
+        SpriteInstance &sprite = scene.sprites[i];
+        sprite.x += scene.dx[i];
+        sprite.y += scene.dy[i];
+        sprite.x -= span * floorf((sprite.x - low) / span);
+        sprite.y -= span * floorf((sprite.y - low) / span);
+    }
+
+    // Counting sort by kind straight into the command buffer
+    thread_local std::vector<uint32_t> counts;
+    thread_local std::vector<SpriteInstance *> outputs;
+    counts.assign(scene.kinds, 0);
+    outputs.assign(scene.kinds, nullptr);
+    for (uint32_t i = begin; i < end; i++)
+        counts[scene.kind[i]]++;
+    for (uint32_t kind = 0; kind < scene.kinds; kind++)
+        if (counts[kind])
+            outputs[kind] = push_sprites(job->render_list, (GameSprite)kind, counts[kind], 0, false, begin);
+    for (uint32_t i = begin; i < end; i++)
+        if (SpriteInstance *&out = outputs[scene.kind[i]])
+            *out++ = scene.sprites[i];
+}
+
+static GLuint create_bench_texture(uint32_t index)
+{
+    // 64x64 checkerboard in a colour of its own
+    const int size = 64;
+    std::vector<uint8_t> pixels(size * size * 4);
+    uint32_t random_state = 0x9E3779B9u * (index + 1);
+    uint8_t color[3] = {(uint8_t)bench_random(random_state), (uint8_t)bench_random(random_state), (uint8_t)bench_random(random_state)};
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+        {
+            uint8_t *pixel = &pixels[(y * size + x) * 4];
+            bool light = ((x / 8) ^ (y / 8)) & 1;
+            for (int c = 0; c < 3; c++)
+                pixel[c] = light ? color[c] : color[c] / 2;
+            pixel[3] = 255;
+        }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    gl_state.bind_texture(texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = (size_t)std::min<double>((double)sorted.size() - 1, floor(p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+static void write_timings(FILE *out, const char *name, std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double sample : samples)
+        sum += sample;
+    fprintf(out, "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n", name,
+            samples.empty() ? 0.0 : sum / samples.size(), percentile(samples, 0.5), percentile(samples, 0.9),
+            percentile(samples, 0.99), samples.empty() ? 0.0 : samples.back());
+}
+
+static double bench_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t bench_thread_index()
+{
+    return (uint32_t)std::max(0, JobSystem::worker_index);
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--sprites") && i + 1 < argc)
+            options.sprites = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--textures") && i + 1 < argc)
+            options.textures = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--shaders") && i + 1 < argc)
+            options.shaders = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--dynamic") && i + 1 < argc)
+            options.dynamic = strtof(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--overdraw") && i + 1 < argc)
+            options.overdraw = strtof(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            options.frames = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+            options.warmup = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            options.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+            options.output = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--sprites N] [--textures N] [--shaders N] [--dynamic 0..1] [--overdraw X] "
+                            "[--frames N] [--warmup N] [--seed N] [--output result.json]\n", argv[0]);
+            return -1;
+        }
+    }
+    // What the sort key and a frame's command buffers can hold
+    options.sprites = std::min(options.sprites, GAME_MAX_SPRITES - 1024);
+    options.textures = std::clamp(options.textures, 1u, 1u << RenderQueue::TEXTURE_BITS);
+    options.shaders = std::clamp(options.shaders, 1u, 1u << RenderQueue::SHADER_BITS);
+    options.dynamic = std::clamp(options.dynamic, 0.0f, 1.0f);
+    options.overdraw = std::max(options.overdraw, 0.0f);
+
+    // Offscreen either way, so the window system's swap and vsync stay out of the numbers
+    HeadlessContext context;
+#ifdef __linux__
+    if (!context.init())
+    {
+        context.destroy();
+        return -1;
+    }
+#else
+    // No EGL: a hidden window's context, drawing into the same framebuffer headless uses
+    GLFWwindow *window = nullptr;
+    if (!glfwInit())
+    {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(context.width, context.height, "bench", NULL, NULL);
+    if (!window)
+    {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK || !context.create_framebuffer())
+    {
+        std::cerr << "Failed to initialize GLEW" << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return -1;
+    }
+#endif
+    gl_call_stats.install();
+    job_system.start();
+
+    StreamBuffer frame_stream;
+    frame_stream.init(GL_ARRAY_BUFFER, 4 * 1024 * 1024); // as main
+    SpriteBatch sprite_batch = {.instanced = true, .presorted = true, .stream = &frame_stream};
+    sprite_batch.init();
+    gl_state.set_blend(true);
+    gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Separate programs from the same source still cost a program switch each
+    std::vector<Shader *> shaders;
+    for (uint32_t i = 0; i < options.shaders; i++)
+        shaders.push_back(new Shader("../res/shaders/sprite_instanced.vert", "../res/shaders/text1.frag"));
+    mat4 view_projection = mat4_ortho(-1, 1, -1, 1, -1, 1);
+    for (Shader *shader : shaders)
+        shader->set_mat4("view_projection", view_projection);
+    std::vector<GLuint> textures;
+    for (uint32_t i = 0; i < options.textures; i++)
+        textures.push_back(create_bench_texture(i));
+
+    BenchScene scene;
+    generate_scene(scene, options);
+    RenderQueue render_queue;
+    render_queue.init(job_system.thread_count());
+    for (uint32_t kind = 0; kind < scene.kinds; kind++)
+        render_queue.set_material((GameSprite)kind, kind % options.shaders, kind / options.shaders);
+
+    GpuProfiler gpu_profiler;
+    gpu_profiler.init();
+
+    // Every batch can push a draw per kind, and one thread may get all the
+    // batches, so with many kinds the batches get bigger to stay in GAME_MAX_DRAWS
+    uint64_t batch_for_draws = ((uint64_t)options.sprites * scene.kinds + GAME_MAX_DRAWS - 1) / GAME_MAX_DRAWS;
+    uint32_t record_batch = (uint32_t)std::clamp<uint64_t>(batch_for_draws, RECORD_BATCH, std::max(options.sprites, 1u));
+
+    std::vector<double> frame_ms, record_ms, sort_ms, submit_ms;
+    uint64_t draws = 0, sprites_recorded = 0, material_changes = 0;
+    for (uint32_t frame = 0; frame < options.warmup + options.frames; frame++)
+    {
+        if (frame == options.warmup)
+        {
+            gl_call_stats.total = {};
+            gl_call_stats.frames = 0;
+            gpu_profiler.gpu_seconds = 0;
+            gpu_profiler.frames_measured = gpu_profiler.frames_dropped = 0;
+            frame_stream.stalls = 0;
+        }
+        bool measured = frame >= options.warmup;
+
+        // From the frame's start to its flush (the last one's finish), so waits on the GPU count
+        double frame_start = bench_seconds();
+
+        gpu_profiler.begin_frame();
+        GameRenderList render_list = render_queue.begin(bench_thread_index);
+        RecordJob job = {&scene, &render_list};
+        job_system.parallel_for(options.sprites, record_batch, record_sprites, &job);
+        double sort_start = bench_seconds();
+        render_queue.sort();
+        double submit_start = bench_seconds();
+        {
+            GPU_ZONE(gpu_profiler, "frame");
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            render_queue.execute([&](const GameDraw &draw, const SpriteInstance *sprites)
+                                 { sprite_batch.draw(*shaders[draw.sprite % options.shaders], textures[draw.sprite / options.shaders], sprites, draw.sprite_count); });
+            sprite_batch.flush();
+        }
+        frame_stream.end_frame();
+        gpu_profiler.end_frame();
+        glFlush(); // what a swap would do
+        double submit_end = bench_seconds();
+        if (frame + 1 == options.warmup + options.frames)
+            glFinish();
+        double frame_end = bench_seconds();
+        if (measured)
+        {
+            frame_ms.push_back((frame_end - frame_start) * 1000);
+            record_ms.push_back((sort_start - frame_start) * 1000);
+            sort_ms.push_back((submit_start - sort_start) * 1000);
+            submit_ms.push_back((submit_end - submit_start) * 1000);
+            draws += render_queue.draws_recorded;
+            sprites_recorded += render_queue.sprites_recorded;
+            material_changes += render_queue.material_changes;
+        }
+        gl_call_stats.end_frame();
+    }
+
+    FILE *out = options.output ? fopen(options.output, "w") : stdout;
+    if (!out)
+    {
+        printf("[%s:%d] Unable to write %s: %s\n", __FILE__, __LINE__, options.output, strerror(errno));
+        return -1;
+    }
+    double frames = std::max(1u, options.frames);
+    const GLFrameStats &gl = gl_call_stats.total;
+    fprintf(out, "{\n");
+    fprintf(out, "  \"renderer\": \"%s\",\n", (const char *)glGetString(GL_RENDERER));
+    fprintf(out, "  \"threads\": %u,\n", job_system.thread_count());
+    fprintf(out, "  \"scene\": {\"sprites\": %u, \"textures\": %u, \"shaders\": %u, \"dynamic\": %.3f, \"overdraw\": %.3f, \"seed\": %u},\n",
+            options.sprites, options.textures, options.shaders, options.dynamic, options.overdraw, options.seed);
+    fprintf(out, "  \"frames\": %u,\n", options.frames);
+    write_timings(out, "frame_ms", frame_ms);
+    write_timings(out, "record_ms", record_ms);
+    write_timings(out, "sort_ms", sort_ms);
+    write_timings(out, "submit_ms", submit_ms);
+    fprintf(out, "  \"gpu_ms\": %.4f,\n", gpu_profiler.frames_measured ? gpu_profiler.gpu_seconds * 1000 / gpu_profiler.frames_measured : 0.0);
+    fprintf(out, "  \"per_frame\": {\"recorded_draws\": %.1f, \"material_changes\": %.1f, \"draw_calls\": %.1f, \"gl_calls\": %.1f, "
+                 "\"binds\": %.1f, \"buffer_bytes\": %.0f, \"texture_bytes\": %.0f},\n",
+            draws / frames, material_changes / frames, gl.draw_calls / frames, gl.calls / frames, gl.binds / frames,
+            gl.buffer_bytes / frames, gl.texture_bytes / frames);
+    // Non-zero when a thread's command buffer filled up, which too many kinds per batch can do
+    fprintf(out, "  \"dropped_sprites\": %.1f,\n", options.sprites - sprites_recorded / frames);
+    fprintf(out, "  \"stream_stalls\": %u\n", frame_stream.stalls);
+    fprintf(out, "}\n");
+    if (out != stdout)
+        fclose(out);
+
+    job_system.stop();
+    context.destroy();
+#ifndef __linux__
+    glfwDestroyWindow(window);
+    glfwTerminate();
+#endif
+    return 0;
+}
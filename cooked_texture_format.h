@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout of a .ctex file written by texture_cooker and read by TextureLoader.
+// CookedTextureHeader, then level_count CookedTextureLevels (level 0 first),
+// then the compressed blocks of each level at CookedTextureLevel::offset.
+// Rows are stored bottom first, like stbi with vertical flip.
+
+static const uint32_t COOKED_TEXTURE_MAGIC = 0x58455443; // "CTEX"
+static const uint32_t COOKED_TEXTURE_VERSION = 1;
+
+// GL_COMPRESSED_RGB_S3TC_DXT1_EXT and GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, without pulling in GL headers
+static const uint32_t COOKED_FORMAT_BC1 = 0x83F0;
+static const uint32_t COOKED_FORMAT_BC3 = 0x83F3;
+
+struct CookedTextureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t gl_format;
+    uint32_t width, height;
+    uint32_t level_count;
+};
+
+struct CookedTextureLevel
+{
+    uint32_t width, height;
+    uint64_t offset; // from the start of the file
+    uint64_t size;
+};
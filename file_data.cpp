@@ -0,0 +1,95 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <algorithm>
+#include <vector>
+
+// Read-only contents of a whole file without size limits or extra copies.
+// Regular files are memory-mapped; anything mmap can't handle (pipes, procfs,
+// empty files) is read into `buffer`, which keeps its capacity so one
+// FileData can be reused for many loads. The data is not NUL terminated.
+struct FileData
+{
+    const char *data = nullptr;
+    size_t size = 0;
+
+    void *mapping = nullptr;
+    size_t mapping_size = 0;
+    std::vector<char> buffer;
+
+    FileData() = default;
+    FileData(const FileData &) = delete;
+    FileData &operator=(const FileData &) = delete;
+    ~FileData() { release(); }
+
+    std::string_view view() const { return std::string_view(data, size); }
+
+    void release()
+    {
+        if (mapping)
+            munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+        data = nullptr;
+        size = 0;
+    }
+
+    // Prints the reason and returns false on failure
+    bool load(const char *path)
+    {
+        release();
+
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            printf("[%s:%d] Unable to open %s: %s\n", __FILE__, __LINE__, path, strerror(errno));
+            return false;
+        }
+
+        struct stat stat_data = {};
+        if (fstat(fd, &stat_data) == 0 && S_ISREG(stat_data.st_mode) && stat_data.st_size > 0)
+        {
+            void *ptr = mmap(NULL, (size_t)stat_data.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED)
+            {
+                madvise(ptr, (size_t)stat_data.st_size, MADV_SEQUENTIAL);
+                madvise(ptr, (size_t)stat_data.st_size, MADV_WILLNEED);
+                close(fd);
+                mapping = ptr;
+                mapping_size = (size_t)stat_data.st_size;
+                data = (const char *)ptr;
+                size = mapping_size;
+                return true;
+            }
+        }
+
+        // Fallback: read until EOF, handling partial reads
+        size_t used = 0;
+        for (;;)
+        {
+            if (buffer.size() - used < 4096)
+                buffer.resize(std::max<size_t>(buffer.size() * 2, 16 * 1024));
+            ssize_t bytes_read = read(fd, buffer.data() + used, buffer.size() - used);
+            if (bytes_read == 0)
+                break;
+            if (bytes_read < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                printf("[%s:%d] Unable to read %s: %s\n", __FILE__, __LINE__, path, strerror(errno));
+                close(fd);
+                return false;
+            }
+            used += (size_t)bytes_read;
+        }
+        close(fd);
+        data = buffer.data();
+        size = used;
+        return true;
+    }
+};
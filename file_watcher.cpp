@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+// Watches directories on its own thread and hands changed file paths
+// ("<directory>/<name>") to the main loop through poll(). Bursts of events
+// (editors and compilers often write a file several times) are coalesced:
+// a path is only reported once nothing under the watch has changed for
+// settle_ms. Uses inotify on Linux and falls back to scanning mtimes
+// elsewhere, still off the main thread.
+struct FileWatcher
+{
+    std::vector<std::string> directories;
+    int settle_ms = 100;
+
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+    std::mutex mutex;
+    std::vector<std::string> changed; // settled, waiting for poll()
+    int wake_fd = -1;
+
+    ~FileWatcher() { stop(); }
+
+    void start(const std::vector<std::string> &watch_directories)
+    {
+        directories = watch_directories;
+        stopping = false;
+#ifdef __linux__
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+        thread = std::thread([this] { run_inotify(); });
+#else
+        thread = std::thread([this] { run_polling(); });
+#endif
+    }
+
+    void stop()
+    {
+        if (!thread.joinable())
+            return;
+        stopping = true;
+#ifdef __linux__
+        uint64_t one = 1;
+        write(wake_fd, &one, sizeof(one));
+#endif
+        thread.join();
+#ifdef __linux__
+        close(wake_fd);
+        wake_fd = -1;
+#endif
+    }
+
+    // Main thread: moves the paths that changed since the last call into paths
+    bool poll(std::vector<std::string> &paths)
+    {
+        paths.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        paths.swap(changed);
+        return !paths.empty();
+    }
+
+    void publish(std::set<std::string> &pending)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &path : pending)
+            if (std::find(changed.begin(), changed.end(), path) == changed.end())
+                changed.push_back(path);
+        pending.clear();
+    }
+
+#ifdef __linux__
+    void run_inotify()
+    {
+        int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (fd == -1)
+        {
+            printf("[%s:%d] inotify_init1 failed: %s\n", __FILE__, __LINE__, strerror(errno));
+            return;
+        }
+        std::vector<int> watches;
+        for (auto &directory : directories)
+        {
+            int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd == -1)
+                printf("[%s:%d] Unable to watch %s: %s\n", __FILE__, __LINE__, directory.c_str(), strerror(errno));
+            watches.push_back(wd);
+        }
+
+        std::set<std::string> pending;
+        alignas(inotify_event) char buffer[16 * 1024];
+        while (!stopping)
+        {
+            pollfd fds[2] = {{fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+            int ready = ::poll(fds, 2, pending.empty() ? -1 : settle_ms);
+            if (ready == 0)
+            {
+                publish(pending); // quiet for settle_ms
+                continue;
+            }
+            if (ready < 0 || !(fds[0].revents & POLLIN))
+                continue;
+
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *ptr = buffer; ptr < buffer + length;)
+                {
+                    auto *event = (inotify_event *)ptr;
+                    ptr += sizeof(inotify_event) + event->len;
+                    if (!event->len)
+                        continue;
+                    for (size_t i = 0; i < watches.size(); i++)
+                        if (watches[i] == event->wd)
+                            pending.insert(directories[i] + "/" + event->name);
+                }
+            }
+        }
+        close(fd);
+    }
+#else
+    void run_polling()
+    {
+        std::vector<std::pair<std::string, time_t>> known; // path, mtime
+        // Returns how many files changed since the last scan
+        auto scan = [&](std::set<std::string> *pending) -> size_t
+        {
+            size_t changes = 0;
+            for (auto &directory : directories)
+            {
+                DIR *dir = opendir(directory.c_str());
+                if (!dir)
+                    continue;
+                while (dirent *entry = readdir(dir))
+                {
+                    if (entry->d_name[0] == '.')
+                        continue;
+                    std::string path = directory + "/" + entry->d_name;
+                    struct stat stat_data = {};
+                    if (stat(path.c_str(), &stat_data) != 0)
+                        continue;
+                    auto it = std::find_if(known.begin(), known.end(), [&](auto &item) { return item.first == path; });
+                    if (it == known.end())
+                        known.push_back({path, stat_data.st_mtime});
+                    else if (it->second != stat_data.st_mtime)
+                        it->second = stat_data.st_mtime;
+                    else
+                        continue;
+                    changes++;
+                    if (pending)
+                        pending->insert(path);
+                }
+                closedir(dir);
+            }
+            return changes;
+        };
+
+        scan(nullptr);
+        std::set<std::string> pending;
+        while (!stopping)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(settle_ms));
+            if (scan(&pending) == 0 && !pending.empty())
+                publish(pending); // quiet for settle_ms
+        }
+    }
+#endif
+};
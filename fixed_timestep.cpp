@@ -0,0 +1,51 @@
+#include <cmath>
+#include <cstdint>
+
+// Runs the simulation at a fixed tick rate whatever the display refresh is.
+// advance() returns how many ticks to simulate this frame; alpha() is how far
+// the frame lies between the last two simulation states, for interpolating
+// what gets drawn.
+struct FixedTimestep
+{
+    double tick_seconds = 1.0 / 60.0;
+    int max_steps = 5; // per frame; past this the simulation slows down instead of spiralling
+
+    double accumulator = 0;
+    double last_time = -1;
+    uint64_t ticks = 0;
+    uint64_t dropped_ticks = 0; // skipped by the max_steps guard
+
+    int advance(double now)
+    {
+        if (last_time < 0)
+            last_time = now;
+        accumulator += now - last_time;
+        last_time = now;
+
+        int steps = (int)(accumulator / tick_seconds);
+        if (steps > max_steps)
+        {
+            dropped_ticks += steps - max_steps;
+            steps = max_steps;
+        }
+        accumulator -= steps * tick_seconds;
+        if (accumulator >= tick_seconds)
+            accumulator = fmod(accumulator, tick_seconds);
+        ticks += steps;
+        return steps;
+    }
+
+    // One tick, no interpolation: for runs that must simulate the same thing
+    // every time whatever the clock says
+    int step()
+    {
+        accumulator = 0;
+        ticks++;
+        return 1;
+    }
+
+    float alpha() const
+    {
+        return (float)(accumulator / tick_seconds);
+    }
+};
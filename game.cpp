@@ -1,22 +1,264 @@
 #include <string>
 #include <iostream>
+#include <cmath>
+#include <cstring>
 
+#include "game.h"
+
+// Bump allocator over the rest of GameMemory after GameState. Nothing is ever
+// freed: whatever is allocated is part of the state and survives reloads.
+struct Arena
+{
+    uint8_t *base;
+    size_t size;
+    size_t used;
+};
+
+static void *push_size(Arena *arena, size_t size, size_t alignment = 64)
+{
+    size_t start = (arena->used + alignment - 1) & ~(alignment - 1);
+    if (start + size > arena->size)
+        return nullptr;
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+template <typename T>
+static T *push_array(Arena *arena, size_t count)
+{
+    return (T *)push_size(arena, count * sizeof(T));
+}
+
+// Sprites that fly clockwise around the edge of the screen, stored as a
+// structure of arrays so each pass streams through only the fields it needs
+// and compiles to vector code. The turn logic is branch free for the same
+// reason; direction is 32 bits wide to match the float lanes.
+struct Patrollers
+{
+    static const uint32_t MAX_COUNT = 1 << 20;
+
+    uint32_t count;
+    float w, h;                      // shared by all
+    float *x, *y;                    // bottom left corner
+    float *previous_x, *previous_y;  // as of the tick before, for interpolation
+    float *dx, *dy;                  // units per second
+    int32_t *direction;              // 0: down, 1: right, 2: up, 3: left
+};
+
+// Raise and rebuild the library to grow the swarm while the game runs
+static const uint32_t PATROLLER_COUNT = 1;
+static const float PLANE_SPEED = 0.3f;
+static const uint32_t PATROLLER_BATCH = 16384; // per job; smaller swarms stay on the calling thread
+
+// Everything the game remembers between frames. Lives at the start of
+// GameMemory::storage so it survives reloads; see game.h.
+struct GameState
+{
+    bool initialized;
+    GameAssets assets;
+    Arena arena;
+    uint32_t random_state;
+
+    SpriteInstance flag;
+
+    Patrollers patrollers;
+    float plane_uvs[4][6]; // per direction, already mapped into the plane's atlas rect
+};
+
+static float random_float(GameState *state, float min, float max)
+{
+    // xorshift32
+    uint32_t x = state->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state->random_state = x;
+    return min + (max - min) * (float)(x >> 8) * (1.0f / (1 << 24));
+}
+
+static void spawn_patroller(Patrollers &patrollers, float x, float y, int32_t direction, float speed)
+{
+    uint32_t i = patrollers.count++;
+    patrollers.x[i] = patrollers.previous_x[i] = x;
+    patrollers.y[i] = patrollers.previous_y[i] = y;
+    patrollers.direction[i] = direction;
+    patrollers.dx[i] = speed * (float)((direction == 1) - (direction == 3));
+    patrollers.dy[i] = speed * (float)((direction == 2) - (direction == 0));
+}
+
+// Patrollers [begin, end); ranges are independent so they can run in parallel
+static void update_patrollers(Patrollers &patrollers, float dt, uint32_t begin, uint32_t end)
+{
+    float *__restrict x = patrollers.x;
+    float *__restrict y = patrollers.y;
+    float *__restrict dx = patrollers.dx;
+    float *__restrict dy = patrollers.dy;
+    int32_t *__restrict direction = patrollers.direction;
+
+    memcpy(patrollers.previous_x + begin, x + begin, (end - begin) * sizeof(float));
+    memcpy(patrollers.previous_y + begin, y + begin, (end - begin) * sizeof(float));
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        x[i] += dx[i] * dt;
+        y[i] += dy[i] * dt;
+    }
+
+    // Turn at the edges, testing the center point of the old per-vertex
+    // version (average of top right, bottom right, bottom left)
+    const float cx_offset = patrollers.w * (2.0f / 3.0f);
+    const float cy_offset = patrollers.h * (1.0f / 3.0f);
+    for (uint32_t i = begin; i < end; i++)
+    {
+        float cx = x[i] + cx_offset;
+        float cy = y[i] + cy_offset;
+        int32_t d = direction[i];
+        int32_t turn = ((d == 0) & (cy <= -0.9f)) | // bottom edge - turn right
+                       ((d == 1) & (cx >= 0.9f)) |  // right edge - turn up
+                       ((d == 2) & (cy >= 0.8f)) |  // top edge - turn left
+                       ((d == 3) & (cx <= -0.8f));  // left edge - turn down
+        d = (d + turn) & 3;
+        direction[i] = d;
+
+        // Only one of dx, dy is ever non-zero
+        float speed = fabsf(dx[i]) + fabsf(dy[i]);
+        dx[i] = speed * (float)((d == 1) - (d == 3));
+        dy[i] = speed * (float)((d == 2) - (d == 0));
+    }
+}
+
+// Writes the final instance data for patrollers [begin, end) to out[0..end - begin),
+// interpolating positions between the last two ticks
+static void write_patrollers(const GameState *state, SpriteInstance *__restrict out, float alpha, uint32_t begin, uint32_t end)
+{
+    const Patrollers &patrollers = state->patrollers;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        SpriteInstance &sprite = out[i - begin];
+        sprite.x = patrollers.previous_x[i] + (patrollers.x[i] - patrollers.previous_x[i]) * alpha;
+        sprite.y = patrollers.previous_y[i] + (patrollers.y[i] - patrollers.previous_y[i]) * alpha;
+        sprite.w = patrollers.w;
+        sprite.h = patrollers.h;
+        memcpy(sprite.uv, state->plane_uvs[patrollers.direction[i]], sizeof(sprite.uv));
+        memset(sprite.color, 255, sizeof(sprite.color));
+    }
+}
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+void game_init(GameMemory *memory, const GameAssets *assets)
+{
+    if (memory->storage_size < sizeof(GameState))
+    {
+        std::cerr << "Game memory too small: " << memory->storage_size << " < " << sizeof(GameState) << std::endl;
+        return;
+    }
+    GameState *state = (GameState *)memory->storage;
+    if (!state->initialized)
+        state->flag = {.x = -0.5f, .y = -0.3f, .w = 1.0f, .h = 0.8f, .color = {255, 255, 255, 255}};
+
+    // The host reloads the atlas when it is rebuilt; refresh everything derived from the rects
+    state->assets = *assets;
+    const float flag_uv[6] = {0, 0, /* across */ 1, 0, /* up */ 0, 1};
+    set_sprite_uv(state->flag, flag_uv, assets->sprites[GAME_SPRITE_FLAG]);
+    const float plane_uvs[4][6] = {
+        {1, 1, /* across */ -1, 0, /* up */ 0, -1}, // down
+        {1, 0, /* across */ 0, 1, /* up */ -1, 0},  // right
+        {1, 0, /* across */ -1, 0, /* up */ 0, 1},  // up
+        {0, 1, /* across */ 0, -1, /* up */ 1, 0},  // left
+    };
+    for (int d = 0; d < 4; d++)
+    {
+        SpriteInstance sprite;
+        set_sprite_uv(sprite, plane_uvs[d], assets->sprites[GAME_SPRITE_PLANE]);
+        memcpy(state->plane_uvs[d], sprite.uv, sizeof(sprite.uv));
+    }
+    if (state->initialized)
+        return;
+
+    state->arena = {(uint8_t *)memory->storage + sizeof(GameState), memory->storage_size - sizeof(GameState), 0};
+    state->random_state = 0x2545F491;
+
+    Patrollers &patrollers = state->patrollers;
+    Arena *arena = &state->arena;
+    uint32_t capacity = Patrollers::MAX_COUNT;
+    patrollers = {.w = 0.3f, .h = 0.3f};
+    patrollers.x = push_array<float>(arena, capacity);
+    patrollers.y = push_array<float>(arena, capacity);
+    patrollers.previous_x = push_array<float>(arena, capacity);
+    patrollers.previous_y = push_array<float>(arena, capacity);
+    patrollers.dx = push_array<float>(arena, capacity);
+    patrollers.dy = push_array<float>(arena, capacity);
+    patrollers.direction = push_array<int32_t>(arena, capacity);
+    if (!patrollers.direction)
+    {
+        std::cerr << "Game memory too small for " << capacity << " patrollers" << std::endl;
+        return;
+    }
 
-void clear_color(float *r, float *g, float *b, float *a)
+    // The original plane, starting at the top left facing down
+    spawn_patroller(patrollers, -1.0f, 0.7f, 0, PLANE_SPEED);
+    state->initialized = true;
+}
+
+void game_update(GameMemory *memory, float dt)
 {
-    *r = .2;
-    *g = .3;
-    *b = .3;
-    *a = 1.;
+    GameState *state = (GameState *)memory->storage;
+    if (!state->initialized)
+        return;
+
+    // The rest of the swarm starts anywhere inside the loop and joins it at the first edge
+    Patrollers &patrollers = state->patrollers;
+    while (patrollers.count < PATROLLER_COUNT && patrollers.count < Patrollers::MAX_COUNT)
+    {
+        float cx = random_float(state, -0.8f, 0.9f), cy = random_float(state, -0.9f, 0.8f);
+        spawn_patroller(patrollers, cx - patrollers.w * (2.0f / 3.0f), cy - patrollers.h * (1.0f / 3.0f),
+                        (int32_t)random_float(state, 0, 4) & 3, random_float(state, 0.5f, 1.5f) * PLANE_SPEED);
+    }
+
+    struct UpdateJob
+    {
+        Patrollers *patrollers;
+        float dt;
+    } update = {&patrollers, dt};
+    memory->parallel_for(patrollers.count, PATROLLER_BATCH, [](void *data, uint32_t begin, uint32_t end)
+                         {
+                             auto *job = (UpdateJob *)data;
+                             update_patrollers(*job->patrollers, job->dt, begin, end);
+                         }, &update);
 }
 
+void game_render(GameMemory *memory, GameRenderList *render_list, float alpha)
+{
+    render_list->clear_color[0] = .2;
+    render_list->clear_color[1] = .3;
+    render_list->clear_color[2] = .3;
+    render_list->clear_color[3] = 1.;
 
+    GameState *state = (GameState *)memory->storage;
+    if (!state->initialized)
+        return;
+    if (SpriteInstance *flag = push_sprites(render_list, GAME_SPRITE_FLAG, 1, 0, false, 0))
+        *flag = state->flag;
+
+    // Each batch records its own draw on whichever thread runs it, at the
+    // depth of its first index so the planes overlap the same way every frame
+    struct WriteJob
+    {
+        const GameState *state;
+        GameRenderList *render_list;
+        float alpha;
+    } write = {state, render_list, alpha};
+    memory->parallel_for(state->patrollers.count, PATROLLER_BATCH, [](void *data, uint32_t begin, uint32_t end)
+                         {
+                             auto *job = (WriteJob *)data;
+                             if (SpriteInstance *planes = push_sprites(job->render_list, GAME_SPRITE_PLANE, end - begin, 1, true, begin))
+                                 write_patrollers(job->state, planes, job->alpha, begin, end);
+                         }, &write);
+}
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Interface between the host (main.cpp) and the hot-reloaded game library (game.cpp).
+//
+// The host owns all memory. GameMemory is allocated once at a fixed address
+// and handed to every entry point, so the game keeps all of its state there
+// and nothing is lost when the library is closed and reopened. State must not
+// point into the library itself (function pointers, string literals): those
+// addresses change on reload. Pointers into GameMemory stay valid.
+
+// One sprite as the instanced path uploads it (44 bytes vs 128 for 4 vertices)
+struct SpriteInstance
+{
+    float x, y, w, h;  // bottom left corner and size
+    float uv[6];       // uv at the bottom left corner, uv step across the width, uv step up the height
+    uint8_t color[4];  // tint
+};
+
+// Part of a texture an image covers, 0..1
+struct UVRect
+{
+    float u0, v0, u1, v1;
+};
+
+// Sets a sprite's uv mapping, given in the image's own 0..1 space, inside rect
+inline void set_sprite_uv(SpriteInstance &sprite, const float uv[6], const UVRect &rect)
+{
+    float du = rect.u1 - rect.u0, dv = rect.v1 - rect.v0;
+    sprite.uv[0] = rect.u0 + uv[0] * du;
+    sprite.uv[1] = rect.v0 + uv[1] * dv;
+    sprite.uv[2] = uv[2] * du;
+    sprite.uv[3] = uv[3] * dv;
+    sprite.uv[4] = uv[4] * du;
+    sprite.uv[5] = uv[5] * dv;
+}
+
+// Runs function(data, begin, end) over [0, count) on the host's job threads,
+// in batches of at least min_batch, and returns when all of it is done
+typedef void parallel_for_fn(uint32_t count, uint32_t min_batch, void (*function)(void *data, uint32_t begin, uint32_t end), void *data);
+
+struct GameMemory
+{
+    void *storage;       // zeroed by the host, never moves or shrinks
+    size_t storage_size;
+    parallel_for_fn *parallel_for;
+};
+
+// Images the game can draw; the host maps each to a shader and texture
+enum GameSprite : uint32_t
+{
+    GAME_SPRITE_FLAG,
+    GAME_SPRITE_PLANE,
+    GAME_SPRITE_COUNT
+};
+
+struct GameAssets
+{
+    UVRect sprites[GAME_SPRITE_COUNT];
+};
+
+// sprite_count sprites of one kind, stored contiguously in the recording
+// thread's buffer. Layers draw in ascending order; within a layer opaque draws
+// come first, grouped by shader and texture, then translucent ones from the
+// lowest depth up. depth is picked by the game so the result doesn't depend
+// on which thread recorded what.
+struct GameDraw
+{
+    GameSprite sprite;
+    uint8_t layer;
+    bool translucent;
+    uint32_t depth;
+    uint32_t first_sprite;
+    uint32_t sprite_count;
+};
+
+static const uint32_t GAME_MAX_SPRITES = (1 << 20) + 1024; // per thread
+static const uint32_t GAME_MAX_DRAWS = 1024;               // per thread
+
+// What one thread recorded this frame, in host memory with room for
+// GAME_MAX_SPRITES sprites and GAME_MAX_DRAWS draws. A cache line apart from
+// its neighbours so threads don't share the counters.
+struct alignas(64) GameCommandBuffer
+{
+    SpriteInstance *sprites;
+    uint32_t sprite_count;
+    GameDraw *draws;
+    uint32_t draw_count;
+};
+
+// Filled by game_render, from the calling thread or parallel_for jobs. Each
+// thread appends to its own buffer without locking; the host merges and
+// sorts them afterwards.
+struct GameRenderList
+{
+    float clear_color[4];
+    GameCommandBuffer *buffers;
+    uint32_t buffer_count;
+    uint32_t (*thread_index)(); // the calling thread's buffer, < buffer_count
+};
+
+// Reserves count sprites of one kind in the calling thread's buffer to write into; NULL when it is full
+inline SpriteInstance *push_sprites(GameRenderList *render_list, GameSprite sprite, uint32_t count,
+                                    uint8_t layer, bool translucent, uint32_t depth)
+{
+    GameCommandBuffer *buffer = &render_list->buffers[render_list->thread_index()];
+    if (buffer->draw_count == GAME_MAX_DRAWS || count > GAME_MAX_SPRITES - buffer->sprite_count)
+        return nullptr;
+    buffer->draws[buffer->draw_count++] = {sprite, layer, translucent, depth, buffer->sprite_count, count};
+    SpriteInstance *result = buffer->sprites + buffer->sprite_count;
+    buffer->sprite_count += count;
+    return result;
+}
+
+// Called after every load. Sets up the state on the first call and refreshes
+// anything that depends on the host (assets) on later ones.
+typedef void game_init_fn(GameMemory *memory, const GameAssets *assets);
+// Advances the simulation by one fixed tick of dt seconds
+typedef void game_update_fn(GameMemory *memory, float dt);
+// alpha (0..1) is how far the frame lies between the previous tick and the latest
+typedef void game_render_fn(GameMemory *memory, GameRenderList *render_list, float alpha);
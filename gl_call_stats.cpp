@@ -0,0 +1,258 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Counts and times the GL calls the renderer makes, per frame and in total,
+// once install() has been called; until then nothing is hooked and GL calls
+// cost what they always did.
+//
+// GLEW reaches everything past GL 1.1 through function pointers
+// (glBufferData is __glewBufferData), so install() swaps those for counting
+// wrappers. GL 1.1 functions are linked directly, so the ones worth counting
+// are sent through pointers of our own the same way; this file has to be
+// included before anything that calls them.
+enum GLCallKind
+{
+    GL_CALL_OTHER,
+    GL_CALL_DRAW,
+    GL_CALL_BIND,
+    GL_CALL_BUFFER_UPLOAD,  // bytes: glBufferData/glBufferSubData data, glMapBufferRange for writing
+    GL_CALL_TEXTURE_UPLOAD, // bytes: image size, whether it comes from client memory or a pixel buffer
+    GL_CALL_SHADER,
+};
+
+// name, pointer GL calls go through, return type, parameters, arguments, kind, bytes uploaded
+#define GL_HOOKS(X)                                                                                                                                   \
+    X(BufferData, __glewBufferData, void, (GLenum target, GLsizeiptr size, const void *data, GLenum usage), (target, size, data, usage),           \
+      GL_CALL_BUFFER_UPLOAD, data ? size : 0)                                                                                                           \
+    X(BufferSubData, __glewBufferSubData, void, (GLenum target, GLintptr offset, GLsizeiptr size, const void *data), (target, offset, size, data),  \
+      GL_CALL_BUFFER_UPLOAD, size)                                                                                                                      \
+    X(MapBufferRange, __glewMapBufferRange, void *, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access),                         \
+      (target, offset, length, access), GL_CALL_BUFFER_UPLOAD, access & GL_MAP_WRITE_BIT ? length : 0)                                                 \
+    X(UnmapBuffer, __glewUnmapBuffer, GLboolean, (GLenum target), (target), GL_CALL_OTHER, 0)                                                           \
+    X(BindBuffer, __glewBindBuffer, void, (GLenum target, GLuint buffer), (target, buffer), GL_CALL_BIND, 0)                                           \
+    X(BindVertexArray, __glewBindVertexArray, void, (GLuint array), (array), GL_CALL_BIND, 0)                                                            \
+    X(BindFramebuffer, __glewBindFramebuffer, void, (GLenum target, GLuint framebuffer), (target, framebuffer), GL_CALL_BIND, 0)                     \
+    X(UseProgram, __glewUseProgram, void, (GLuint program), (program), GL_CALL_BIND, 0)                                                                  \
+    X(ActiveTexture, __glewActiveTexture, void, (GLenum texture), (texture), GL_CALL_BIND, 0)                                                            \
+    X(VertexAttribPointer, __glewVertexAttribPointer, void,                                                                                            \
+      (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer),                                               \
+      (index, size, type, normalized, stride, pointer), GL_CALL_OTHER, 0)                                                                               \
+    X(DrawElementsInstanced, __glewDrawElementsInstanced, void, (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances),   \
+      (mode, count, type, indices, instances), GL_CALL_DRAW, 0)                                                                                         \
+    X(DrawElementsBaseVertex, __glewDrawElementsBaseVertex, void, (GLenum mode, GLsizei count, GLenum type, const void *indices, GLint base_vertex), \
+      (mode, count, type, indices, base_vertex), GL_CALL_DRAW, 0)                                                                                       \
+    X(ProgramUniform1i, __glewProgramUniform1i, void, (GLuint program, GLint location, GLint v0), (program, location, v0), GL_CALL_OTHER, 0)          \
+    X(ProgramUniform1f, __glewProgramUniform1f, void, (GLuint program, GLint location, GLfloat v0), (program, location, v0), GL_CALL_OTHER, 0)        \
+    X(ProgramUniform2fv, __glewProgramUniform2fv, void, (GLuint program, GLint location, GLsizei count, const GLfloat *value),                       \
+      (program, location, count, value), GL_CALL_OTHER, 0)                                                                                              \
+    X(ProgramUniform3fv, __glewProgramUniform3fv, void, (GLuint program, GLint location, GLsizei count, const GLfloat *value),                       \
+      (program, location, count, value), GL_CALL_OTHER, 0)                                                                                              \
+    X(ProgramUniform4fv, __glewProgramUniform4fv, void, (GLuint program, GLint location, GLsizei count, const GLfloat *value),                       \
+      (program, location, count, value), GL_CALL_OTHER, 0)                                                                                              \
+    X(ProgramUniformMatrix3fv, __glewProgramUniformMatrix3fv, void,                                                                                    \
+      (GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value), (program, location, count, transpose, value),        \
+      GL_CALL_OTHER, 0)                                                                                                                                 \
+    X(ProgramUniformMatrix4fv, __glewProgramUniformMatrix4fv, void,                                                                                    \
+      (GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value), (program, location, count, transpose, value),        \
+      GL_CALL_OTHER, 0)                                                                                                                                 \
+    X(CompileShader, __glewCompileShader, void, (GLuint shader), (shader), GL_CALL_SHADER, 0)                                                          \
+    X(LinkProgram, __glewLinkProgram, void, (GLuint program), (program), GL_CALL_SHADER, 0)                                                            \
+    X(ProgramBinary, __glewProgramBinary, void, (GLuint program, GLenum format, const void *binary, GLsizei length),                                 \
+      (program, format, binary, length), GL_CALL_SHADER, 0)                                                                                            \
+    X(CompressedTexImage2D, __glewCompressedTexImage2D, void,                                                                                          \
+      (GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height, GLint border, GLsizei size, const void *data),                         \
+      (target, level, format, width, height, border, size, data), GL_CALL_TEXTURE_UPLOAD, size)                                                         \
+    X(GenerateMipmap, __glewGenerateMipmap, void, (GLenum target), (target), GL_CALL_OTHER, 0)                                                         \
+    X(FenceSync, __glewFenceSync, GLsync, (GLenum condition, GLbitfield flags), (condition, flags), GL_CALL_OTHER, 0)                                 \
+    X(ClientWaitSync, __glewClientWaitSync, GLenum, (GLsync sync, GLbitfield flags, GLuint64 timeout), (sync, flags, timeout), GL_CALL_OTHER, 0)      \
+    X(BindTexture, gl11_BindTexture, void, (GLenum target, GLuint texture), (target, texture), GL_CALL_BIND, 0)                                       \
+    X(TexImage2D, gl11_TexImage2D, void,                                                                                                               \
+      (GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *data),   \
+      (target, level, internal_format, width, height, border, format, type, data), GL_CALL_TEXTURE_UPLOAD,                                             \
+      gl_image_bytes(width, height, format, type))                                                                                                      \
+    X(TexParameteri, gl11_TexParameteri, void, (GLenum target, GLenum name, GLint param), (target, name, param), GL_CALL_OTHER, 0)                    \
+    X(Clear, gl11_Clear, void, (GLbitfield mask), (mask), GL_CALL_OTHER, 0)                                                                           \
+    X(Enable, gl11_Enable, void, (GLenum capability), (capability), GL_CALL_OTHER, 0)                                                                 \
+    X(Disable, gl11_Disable, void, (GLenum capability), (capability), GL_CALL_OTHER, 0)                                                               \
+    X(BlendFunc, gl11_BlendFunc, void, (GLenum source, GLenum destination), (source, destination), GL_CALL_OTHER, 0)
+
+// The GL 1.1 half of the pointers, starting out at the real functions. The
+// last few aren't counted; gl_capture.cpp hooks them to record them.
+static decltype(&::glBindTexture) gl11_BindTexture = ::glBindTexture;
+static decltype(&::glTexImage2D) gl11_TexImage2D = ::glTexImage2D;
+static decltype(&::glTexParameteri) gl11_TexParameteri = ::glTexParameteri;
+static decltype(&::glClear) gl11_Clear = ::glClear;
+static decltype(&::glEnable) gl11_Enable = ::glEnable;
+static decltype(&::glDisable) gl11_Disable = ::glDisable;
+static decltype(&::glBlendFunc) gl11_BlendFunc = ::glBlendFunc;
+static decltype(&::glGenTextures) gl11_GenTextures = ::glGenTextures;
+static decltype(&::glDeleteTextures) gl11_DeleteTextures = ::glDeleteTextures;
+static decltype(&::glPixelStorei) gl11_PixelStorei = ::glPixelStorei;
+static decltype(&::glViewport) gl11_Viewport = ::glViewport;
+static decltype(&::glClearColor) gl11_ClearColor = ::glClearColor;
+#define glBindTexture GLEW_GET_FUN(gl11_BindTexture)
+#define glTexImage2D GLEW_GET_FUN(gl11_TexImage2D)
+#define glTexParameteri GLEW_GET_FUN(gl11_TexParameteri)
+#define glClear GLEW_GET_FUN(gl11_Clear)
+#define glEnable GLEW_GET_FUN(gl11_Enable)
+#define glDisable GLEW_GET_FUN(gl11_Disable)
+#define glBlendFunc GLEW_GET_FUN(gl11_BlendFunc)
+#define glGenTextures GLEW_GET_FUN(gl11_GenTextures)
+#define glDeleteTextures GLEW_GET_FUN(gl11_DeleteTextures)
+#define glPixelStorei GLEW_GET_FUN(gl11_PixelStorei)
+#define glViewport GLEW_GET_FUN(gl11_Viewport)
+#define glClearColor GLEW_GET_FUN(gl11_ClearColor)
+
+// Only the formats and types this renderer uploads are exact; others count 4 bytes per pixel
+static uint64_t gl_image_bytes(GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+    uint64_t components = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+    uint64_t component_size = type == GL_UNSIGNED_BYTE ? 1 : 4;
+    return (uint64_t)width * height * components * component_size;
+}
+
+enum GLHook
+{
+#define GL_HOOK_ENUM(name, pointer, ret, params, args, kind, bytes) GL_HOOK_##name,
+    GL_HOOKS(GL_HOOK_ENUM)
+#undef GL_HOOK_ENUM
+    GL_HOOK_COUNT
+};
+
+// One frame's worth, or all of them summed
+struct GLFrameStats
+{
+    uint32_t calls;
+    uint32_t draw_calls;
+    uint32_t binds;
+    uint32_t buffer_uploads;
+    uint32_t texture_uploads;
+    uint32_t shader_calls;
+    uint64_t buffer_bytes;
+    uint64_t texture_bytes;
+    double seconds; // spent inside the counted calls, on the CPU
+
+    void add(const GLFrameStats &other)
+    {
+        calls += other.calls;
+        draw_calls += other.draw_calls;
+        binds += other.binds;
+        buffer_uploads += other.buffer_uploads;
+        texture_uploads += other.texture_uploads;
+        shader_calls += other.shader_calls;
+        buffer_bytes += other.buffer_bytes;
+        texture_bytes += other.texture_bytes;
+        seconds += other.seconds;
+    }
+};
+
+// GL thread only, like the calls it counts
+struct GLCallStats
+{
+    struct Function
+    {
+        const char *name;
+        uint64_t calls;
+        double seconds;
+    };
+
+    bool installed = false;
+    Function functions[GL_HOOK_COUNT] = {
+#define GL_HOOK_NAME(name, pointer, ret, params, args, kind, bytes) {"gl" #name, 0, 0},
+        GL_HOOKS(GL_HOOK_NAME)
+#undef GL_HOOK_NAME
+    };
+    GLFrameStats frame = {};      // so far this frame
+    GLFrameStats last_frame = {}; // the last complete one, for budgets
+    GLFrameStats total = {};      // every complete frame
+    uint64_t frames = 0;
+
+    void install();
+
+    void record(GLHook hook, GLCallKind kind, uint64_t bytes, double seconds)
+    {
+        functions[hook].calls++;
+        functions[hook].seconds += seconds;
+        frame.calls++;
+        frame.seconds += seconds;
+        switch (kind)
+        {
+        case GL_CALL_DRAW: frame.draw_calls++; break;
+        case GL_CALL_BIND: frame.binds++; break;
+        case GL_CALL_BUFFER_UPLOAD: frame.buffer_uploads++; frame.buffer_bytes += bytes; break;
+        case GL_CALL_TEXTURE_UPLOAD: frame.texture_uploads++; frame.texture_bytes += bytes; break;
+        case GL_CALL_SHADER: frame.shader_calls++; break;
+        case GL_CALL_OTHER: break;
+        }
+    }
+
+    void end_frame()
+    {
+        last_frame = frame;
+        total.add(frame);
+        frame = {};
+        frames++;
+    }
+
+    void print() const
+    {
+        if (!installed || !frames)
+            return;
+        double n = (double)frames;
+        printf("GL calls per frame: %.1f calls (%.1f draws, %.1f binds), %.1f buffer uploads of %.1f KB, "
+               "%.1f texture uploads of %.1f KB, %.3f ms inside GL\n",
+               total.calls / n, total.draw_calls / n, total.binds / n, total.buffer_uploads / n, total.buffer_bytes / n / 1024,
+               total.texture_uploads / n, total.texture_bytes / n / 1024, total.seconds * 1000 / n);
+
+        // Calls made outside complete frames (startup, shutdown) are in the per-function totals too
+        const Function *sorted[GL_HOOK_COUNT];
+        for (int i = 0; i < GL_HOOK_COUNT; i++)
+            sorted[i] = &functions[i];
+        std::sort(sorted, sorted + GL_HOOK_COUNT, [](const Function *a, const Function *b) { return a->seconds > b->seconds; });
+        for (const Function *function : sorted)
+            if (function->calls)
+                printf("  %-26s %10llu calls %10.3f ms\n", function->name, (unsigned long long)function->calls, function->seconds * 1000);
+    }
+};
+
+GLCallStats gl_call_stats;
+
+struct GLCallTimer
+{
+    GLHook hook;
+    GLCallKind kind;
+    uint64_t bytes;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    ~GLCallTimer()
+    {
+        gl_call_stats.record(hook, kind, bytes, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+#define GL_HOOK_WRAPPER(name, pointer, ret, params, args, kind, bytes) \
+    static decltype(pointer) gl_original_##name;                       \
+    static ret GLAPIENTRY gl_counted_##name params                     \
+    {                                                                  \
+        GLCallTimer timer = {GL_HOOK_##name, kind, (uint64_t)(bytes)}; \
+        return gl_original_##name args;                                \
+    }
+GL_HOOKS(GL_HOOK_WRAPPER)
+#undef GL_HOOK_WRAPPER
+
+// After GLEW is initialized, on the GL thread
+void GLCallStats::install()
+{
+    if (installed)
+        return;
+#define GL_HOOK_INSTALL(name, pointer, ret, params, args, kind, bytes) \
+    gl_original_##name = pointer;                                     \
+    if (gl_original_##name)                                           \
+        pointer = gl_counted_##name;
+    GL_HOOKS(GL_HOOK_INSTALL)
+#undef GL_HOOK_INSTALL
+    installed = true;
+}
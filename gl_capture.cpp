@@ -0,0 +1,706 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "gl_capture_format.h"
+
+// Records every GL call that changes what gets drawn, from start() on, into a
+// .glcap file (see gl_capture_format.h) that replay re-executes headless
+// without the game, its library or its assets. Hooks the same GLEW and
+// gl11_ pointers as gl_call_stats.cpp, so it has to be included after it;
+// queries and other calls that only read state back aren't recorded.
+//
+// Payloads are hashed and written once: static geometry, textures and
+// shaders cost their size a single time however often they are uploaded,
+// and only what really changes is written again each frame. What the
+// renderer writes through glMapBufferRange is read out of the mapping at
+// glUnmapBuffer.
+//
+// Start before anything is created, since replay only knows objects it saw
+// being made; GL thread only.
+struct GLCapture
+{
+    struct Mapping
+    {
+        GLenum target;
+        void *pointer;
+        GLsizeiptr length;
+    };
+
+    FILE *file = nullptr;
+    const char *path = nullptr;
+    bool installed = false;
+    std::unordered_map<uint64_t, uint32_t> blobs; // hash of the contents -> blob id
+    std::vector<Mapping> mappings;                // mapped for writing right now
+    GLuint unpack_buffer = 0;                     // texture uploads read from it instead of client memory
+    GLint unpack_alignment = 4;
+
+    uint64_t frames = 0;
+    uint64_t calls = 0;
+    uint64_t payload_bytes = 0;      // blobs written
+    uint64_t deduplicated_bytes = 0; // payloads that were already in the file
+
+    bool start(const char *capture_file, int width, int height);
+    void install();
+
+    void end_frame()
+    {
+        if (!file)
+            return;
+        put(GL_CAPTURE_END_FRAME);
+        frames++;
+    }
+
+    bool stop()
+    {
+        if (!file)
+            return false;
+        bool ok = !ferror(file);
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        if (!ok)
+            printf("[%s:%d] Unable to write %s: %s\n", __FILE__, __LINE__, path, strerror(errno));
+        return ok;
+    }
+
+    template <typename T>
+    void put(T value)
+    {
+        fwrite(&value, sizeof(value), 1, file);
+    }
+
+    void put_bytes(const void *data, size_t size)
+    {
+        fwrite(data, 1, size, file);
+    }
+
+    // Blobs have to be written before the record that refers to them starts
+    template <typename... T>
+    void record(GLCaptureOp op, T... fields)
+    {
+        put(op);
+        (put(fields), ...);
+        calls++;
+    }
+
+    void record_names(GLCaptureOp op, GLsizei count, const GLuint *names)
+    {
+        record(op, count);
+        put_bytes(names, sizeof(GLuint) * count);
+    }
+
+    // Returns the id of a blob holding size bytes of data, writing it if it's new. A
+    // 64-bit hash mixed with the size is taken as the identity of the contents.
+    uint32_t blob(const void *data, uint64_t size)
+    {
+        if (!data)
+            return 0;
+        uint64_t hash = hash_bytes(data, size);
+        auto found = blobs.find(hash);
+        if (found != blobs.end())
+        {
+            deduplicated_bytes += size;
+            return found->second;
+        }
+        uint32_t id = (uint32_t)blobs.size() + 1;
+        blobs.emplace(hash, id);
+        put(GL_CAPTURE_BLOB);
+        put(id);
+        put(size);
+        put_bytes(data, size);
+        payload_bytes += size;
+        return id;
+    }
+
+    // Eight bytes a step; FNV-1a a byte at a time would cost about as much as the upload
+    static uint64_t hash_bytes(const void *data, uint64_t size)
+    {
+        const uint8_t *bytes = (const uint8_t *)data;
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+        uint64_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i, 8);
+            hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 32;
+        }
+        for (; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    // Client memory glTexImage2D reads, rows padded to GL_UNPACK_ALIGNMENT
+    uint64_t image_bytes(GLsizei width, GLsizei height, GLenum format, GLenum type) const
+    {
+        if (width <= 0 || height <= 0)
+            return 0;
+        uint64_t row = gl_image_bytes(width, 1, format, type);
+        uint64_t stride = (row + unpack_alignment - 1) / unpack_alignment * unpack_alignment;
+        return stride * (height - 1) + row;
+    }
+
+    void print() const
+    {
+        if (!installed)
+            return;
+        printf("Captured %llu frames, %llu GL calls into %s: %.1f MB of payload, %.1f MB more deduplicated\n",
+               (unsigned long long)frames, (unsigned long long)calls, path, payload_bytes / (1024.0 * 1024.0),
+               deduplicated_bytes / (1024.0 * 1024.0));
+    }
+};
+
+GLCapture gl_capture;
+
+// name, pointer GL calls go through
+#define GL_CAPTURE_HOOKS(X)                                   \
+    X(GenBuffers, __glewGenBuffers)                           \
+    X(DeleteBuffers, __glewDeleteBuffers)                     \
+    X(BindBuffer, __glewBindBuffer)                           \
+    X(BufferData, __glewBufferData)                           \
+    X(BufferSubData, __glewBufferSubData)                     \
+    X(MapBufferRange, __glewMapBufferRange)                   \
+    X(UnmapBuffer, __glewUnmapBuffer)                         \
+    X(GenVertexArrays, __glewGenVertexArrays)                 \
+    X(DeleteVertexArrays, __glewDeleteVertexArrays)           \
+    X(BindVertexArray, __glewBindVertexArray)                 \
+    X(VertexAttribPointer, __glewVertexAttribPointer)         \
+    X(EnableVertexAttribArray, __glewEnableVertexAttribArray) \
+    X(VertexAttribDivisor, __glewVertexAttribDivisor)         \
+    X(GenTextures, gl11_GenTextures)                          \
+    X(DeleteTextures, gl11_DeleteTextures)                    \
+    X(ActiveTexture, __glewActiveTexture)                     \
+    X(BindTexture, gl11_BindTexture)                          \
+    X(TexImage2D, gl11_TexImage2D)                            \
+    X(CompressedTexImage2D, __glewCompressedTexImage2D)       \
+    X(TexParameteri, gl11_TexParameteri)                      \
+    X(GenerateMipmap, __glewGenerateMipmap)                   \
+    X(PixelStorei, gl11_PixelStorei)                          \
+    X(CreateShader, __glewCreateShader)                       \
+    X(ShaderSource, __glewShaderSource)                       \
+    X(CompileShader, __glewCompileShader)                     \
+    X(DeleteShader, __glewDeleteShader)                       \
+    X(CreateProgram, __glewCreateProgram)                     \
+    X(AttachShader, __glewAttachShader)                       \
+    X(ProgramParameteri, __glewProgramParameteri)             \
+    X(LinkProgram, __glewLinkProgram)                         \
+    X(ProgramBinary, __glewProgramBinary)                     \
+    X(DeleteProgram, __glewDeleteProgram)                     \
+    X(UseProgram, __glewUseProgram)                           \
+    X(GetUniformLocation, __glewGetUniformLocation)           \
+    X(ProgramUniform1i, __glewProgramUniform1i)               \
+    X(ProgramUniform1f, __glewProgramUniform1f)               \
+    X(ProgramUniform2fv, __glewProgramUniform2fv)             \
+    X(ProgramUniform3fv, __glewProgramUniform3fv)             \
+    X(ProgramUniform4fv, __glewProgramUniform4fv)             \
+    X(ProgramUniformMatrix3fv, __glewProgramUniformMatrix3fv) \
+    X(ProgramUniformMatrix4fv, __glewProgramUniformMatrix4fv) \
+    X(BindFramebuffer, __glewBindFramebuffer)                 \
+    X(Viewport, gl11_Viewport)                                \
+    X(ClearColor, gl11_ClearColor)                            \
+    X(Clear, gl11_Clear)                                      \
+    X(Enable, gl11_Enable)                                    \
+    X(Disable, gl11_Disable)                                  \
+    X(BlendFunc, gl11_BlendFunc)                              \
+    X(DrawElementsInstanced, __glewDrawElementsInstanced)     \
+    X(DrawElementsBaseVertex, __glewDrawElementsBaseVertex)   \
+    X(FenceSync, __glewFenceSync)                             \
+    X(ClientWaitSync, __glewClientWaitSync)                   \
+    X(DeleteSync, __glewDeleteSync)
+
+#define GL_CAPTURE_ORIGINAL(name, pointer) static decltype(pointer) gl_uncaptured_##name;
+GL_CAPTURE_HOOKS(GL_CAPTURE_ORIGINAL)
+#undef GL_CAPTURE_ORIGINAL
+
+// Each calls through, then records the call once it's known to have happened
+static void GLAPIENTRY gl_captured_GenBuffers(GLsizei count, GLuint *buffers)
+{
+    gl_uncaptured_GenBuffers(count, buffers);
+    if (gl_capture.file)
+        gl_capture.record_names(GL_CAPTURE_GEN_BUFFERS, count, buffers);
+}
+
+static void GLAPIENTRY gl_captured_DeleteBuffers(GLsizei count, const GLuint *buffers)
+{
+    for (GLsizei i = 0; i < count; i++)
+        if (buffers[i] == gl_capture.unpack_buffer)
+            gl_capture.unpack_buffer = 0;
+    gl_uncaptured_DeleteBuffers(count, buffers);
+    if (gl_capture.file)
+        gl_capture.record_names(GL_CAPTURE_DELETE_BUFFERS, count, buffers);
+}
+
+static void GLAPIENTRY gl_captured_BindBuffer(GLenum target, GLuint buffer)
+{
+    if (target == GL_PIXEL_UNPACK_BUFFER)
+        gl_capture.unpack_buffer = buffer;
+    gl_uncaptured_BindBuffer(target, buffer);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_BIND_BUFFER, target, buffer);
+}
+
+static void GLAPIENTRY gl_captured_BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    gl_uncaptured_BufferData(target, size, data, usage);
+    if (gl_capture.file)
+    {
+        uint32_t blob = gl_capture.blob(data, (uint64_t)size);
+        gl_capture.record(GL_CAPTURE_BUFFER_DATA, target, (int64_t)size, blob, usage);
+    }
+}
+
+static void GLAPIENTRY gl_captured_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+    gl_uncaptured_BufferSubData(target, offset, size, data);
+    if (gl_capture.file)
+    {
+        uint32_t blob = gl_capture.blob(data, (uint64_t)size);
+        gl_capture.record(GL_CAPTURE_BUFFER_SUB_DATA, target, (int64_t)offset, (int64_t)size, blob);
+    }
+}
+
+static void *GLAPIENTRY gl_captured_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    void *pointer = gl_uncaptured_MapBufferRange(target, offset, length, access);
+    if (gl_capture.file)
+    {
+        gl_capture.record(GL_CAPTURE_MAP_BUFFER_RANGE, target, (int64_t)offset, (int64_t)length, access);
+        if (pointer && (access & GL_MAP_WRITE_BIT))
+            gl_capture.mappings.push_back({target, pointer, length});
+    }
+    return pointer;
+}
+
+static GLboolean GLAPIENTRY gl_captured_UnmapBuffer(GLenum target)
+{
+    // Read what was written before the mapping goes away
+    if (gl_capture.file)
+    {
+        uint32_t blob = 0;
+        auto &mappings = gl_capture.mappings;
+        auto mapping = std::find_if(mappings.begin(), mappings.end(), [&](const GLCapture::Mapping &m) { return m.target == target; });
+        if (mapping != mappings.end())
+        {
+            blob = gl_capture.blob(mapping->pointer, (uint64_t)mapping->length);
+            mappings.erase(mapping);
+        }
+        gl_capture.record(GL_CAPTURE_UNMAP_BUFFER, target, blob);
+    }
+    return gl_uncaptured_UnmapBuffer(target);
+}
+
+static void GLAPIENTRY gl_captured_GenVertexArrays(GLsizei count, GLuint *arrays)
+{
+    gl_uncaptured_GenVertexArrays(count, arrays);
+    if (gl_capture.file)
+        gl_capture.record_names(GL_CAPTURE_GEN_VERTEX_ARRAYS, count, arrays);
+}
+
+static void GLAPIENTRY gl_captured_DeleteVertexArrays(GLsizei count, const GLuint *arrays)
+{
+    gl_uncaptured_DeleteVertexArrays(count, arrays);
+    if (gl_capture.file)
+        gl_capture.record_names(GL_CAPTURE_DELETE_VERTEX_ARRAYS, count, arrays);
+}
+
+static void GLAPIENTRY gl_captured_BindVertexArray(GLuint array)
+{
+    gl_uncaptured_BindVertexArray(array);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_BIND_VERTEX_ARRAY, array);
+}
+
+// Attributes always come from a buffer here, so the pointer is an offset into it
+static void GLAPIENTRY gl_captured_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                                                       const void *pointer)
+{
+    gl_uncaptured_VertexAttribPointer(index, size, type, normalized, stride, pointer);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_VERTEX_ATTRIB_POINTER, index, size, type, normalized, stride, (uint64_t)(uintptr_t)pointer);
+}
+
+static void GLAPIENTRY gl_captured_EnableVertexAttribArray(GLuint index)
+{
+    gl_uncaptured_EnableVertexAttribArray(index);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+static void GLAPIENTRY gl_captured_VertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    gl_uncaptured_VertexAttribDivisor(index, divisor);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_VERTEX_ATTRIB_DIVISOR, index, divisor);
+}
+
+static void GLAPIENTRY gl_captured_GenTextures(GLsizei count, GLuint *textures)
+{
+    gl_uncaptured_GenTextures(count, textures);
+    if (gl_capture.file)
+        gl_capture.record_names(GL_CAPTURE_GEN_TEXTURES, count, textures);
+}
+
+static void GLAPIENTRY gl_captured_DeleteTextures(GLsizei count, const GLuint *textures)
+{
+    gl_uncaptured_DeleteTextures(count, textures);
+    if (gl_capture.file)
+        gl_capture.record_names(GL_CAPTURE_DELETE_TEXTURES, count, textures);
+}
+
+static void GLAPIENTRY gl_captured_ActiveTexture(GLenum unit)
+{
+    gl_uncaptured_ActiveTexture(unit);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_ACTIVE_TEXTURE, unit);
+}
+
+static void GLAPIENTRY gl_captured_BindTexture(GLenum target, GLuint texture)
+{
+    gl_uncaptured_BindTexture(target, texture);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_BIND_TEXTURE, target, texture);
+}
+
+// From a pixel unpack buffer the data pointer is an offset into it; otherwise the pixels go in a blob
+static void GLAPIENTRY gl_captured_TexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height,
+                                              GLint border, GLenum format, GLenum type, const void *data)
+{
+    gl_uncaptured_TexImage2D(target, level, internal_format, width, height, border, format, type, data);
+    if (gl_capture.file)
+    {
+        bool from_buffer = gl_capture.unpack_buffer != 0;
+        uint32_t blob = from_buffer ? 0 : gl_capture.blob(data, gl_capture.image_bytes(width, height, format, type));
+        gl_capture.record(GL_CAPTURE_TEX_IMAGE_2D, target, level, internal_format, width, height, border, format, type, blob,
+                          (uint64_t)(from_buffer ? (uintptr_t)data : 0));
+    }
+}
+
+static void GLAPIENTRY gl_captured_CompressedTexImage2D(GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height,
+                                                        GLint border, GLsizei size, const void *data)
+{
+    gl_uncaptured_CompressedTexImage2D(target, level, format, width, height, border, size, data);
+    if (gl_capture.file)
+    {
+        bool from_buffer = gl_capture.unpack_buffer != 0;
+        uint32_t blob = from_buffer ? 0 : gl_capture.blob(data, (uint64_t)size);
+        gl_capture.record(GL_CAPTURE_COMPRESSED_TEX_IMAGE_2D, target, level, format, width, height, border, size, blob,
+                          (uint64_t)(from_buffer ? (uintptr_t)data : 0));
+    }
+}
+
+static void GLAPIENTRY gl_captured_TexParameteri(GLenum target, GLenum name, GLint param)
+{
+    gl_uncaptured_TexParameteri(target, name, param);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_TEX_PARAMETERI, target, name, param);
+}
+
+static void GLAPIENTRY gl_captured_GenerateMipmap(GLenum target)
+{
+    gl_uncaptured_GenerateMipmap(target);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_GENERATE_MIPMAP, target);
+}
+
+static void GLAPIENTRY gl_captured_PixelStorei(GLenum name, GLint param)
+{
+    if (name == GL_UNPACK_ALIGNMENT)
+        gl_capture.unpack_alignment = param;
+    gl_uncaptured_PixelStorei(name, param);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_PIXEL_STOREI, name, param);
+}
+
+static GLuint GLAPIENTRY gl_captured_CreateShader(GLenum type)
+{
+    GLuint shader = gl_uncaptured_CreateShader(type);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_CREATE_SHADER, type, shader);
+    return shader;
+}
+
+// A blob per string, then the count and their ids
+static void GLAPIENTRY gl_captured_ShaderSource(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths)
+{
+    gl_uncaptured_ShaderSource(shader, count, strings, lengths);
+    if (gl_capture.file)
+    {
+        std::vector<uint32_t> blobs(count);
+        for (GLsizei i = 0; i < count; i++)
+            blobs[i] = gl_capture.blob(strings[i], lengths && lengths[i] >= 0 ? (uint64_t)lengths[i] : strlen(strings[i]));
+        gl_capture.record(GL_CAPTURE_SHADER_SOURCE, shader, count);
+        gl_capture.put_bytes(blobs.data(), sizeof(uint32_t) * count);
+    }
+}
+
+static void GLAPIENTRY gl_captured_CompileShader(GLuint shader)
+{
+    gl_uncaptured_CompileShader(shader);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_COMPILE_SHADER, shader);
+}
+
+static void GLAPIENTRY gl_captured_DeleteShader(GLuint shader)
+{
+    gl_uncaptured_DeleteShader(shader);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_DELETE_SHADER, shader);
+}
+
+static GLuint GLAPIENTRY gl_captured_CreateProgram()
+{
+    GLuint program = gl_uncaptured_CreateProgram();
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_CREATE_PROGRAM, program);
+    return program;
+}
+
+static void GLAPIENTRY gl_captured_AttachShader(GLuint program, GLuint shader)
+{
+    gl_uncaptured_AttachShader(program, shader);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_ATTACH_SHADER, program, shader);
+}
+
+static void GLAPIENTRY gl_captured_ProgramParameteri(GLuint program, GLenum name, GLint value)
+{
+    gl_uncaptured_ProgramParameteri(program, name, value);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_PROGRAM_PARAMETERI, program, name, value);
+}
+
+static void GLAPIENTRY gl_captured_LinkProgram(GLuint program)
+{
+    gl_uncaptured_LinkProgram(program);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_LINK_PROGRAM, program);
+}
+
+// Binaries from the program cache only load on the driver that wrote them
+static void GLAPIENTRY gl_captured_ProgramBinary(GLuint program, GLenum format, const void *binary, GLsizei length)
+{
+    gl_uncaptured_ProgramBinary(program, format, binary, length);
+    if (gl_capture.file)
+    {
+        uint32_t blob = gl_capture.blob(binary, (uint64_t)length);
+        gl_capture.record(GL_CAPTURE_PROGRAM_BINARY, program, format, blob, length);
+    }
+}
+
+static void GLAPIENTRY gl_captured_DeleteProgram(GLuint program)
+{
+    gl_uncaptured_DeleteProgram(program);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_DELETE_PROGRAM, program);
+}
+
+static void GLAPIENTRY gl_captured_UseProgram(GLuint program)
+{
+    gl_uncaptured_UseProgram(program);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_USE_PROGRAM, program);
+}
+
+// Recorded with the answer, so replay can map this driver's locations onto its own
+static GLint GLAPIENTRY gl_captured_GetUniformLocation(GLuint program, const GLchar *name)
+{
+    GLint location = gl_uncaptured_GetUniformLocation(program, name);
+    if (gl_capture.file)
+    {
+        uint32_t blob = gl_capture.blob(name, strlen(name));
+        gl_capture.record(GL_CAPTURE_GET_UNIFORM_LOCATION, program, blob, location);
+    }
+    return location;
+}
+
+static void GLAPIENTRY gl_captured_ProgramUniform1i(GLuint program, GLint location, GLint value)
+{
+    gl_uncaptured_ProgramUniform1i(program, location, value);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_PROGRAM_UNIFORM_1I, program, location, value);
+}
+
+static void GLAPIENTRY gl_captured_ProgramUniform1f(GLuint program, GLint location, GLfloat value)
+{
+    gl_uncaptured_ProgramUniform1f(program, location, value);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_PROGRAM_UNIFORM_1F, program, location, value);
+}
+
+// Uniform values are small enough to go inline rather than in blobs
+static void capture_program_uniform(GLuint program, GLint location, GLsizei count, uint8_t components, const GLfloat *values)
+{
+    gl_capture.record(GL_CAPTURE_PROGRAM_UNIFORM_FV, program, location, count, components);
+    gl_capture.put_bytes(values, sizeof(GLfloat) * components * count);
+}
+
+static void GLAPIENTRY gl_captured_ProgramUniform2fv(GLuint program, GLint location, GLsizei count, const GLfloat *values)
+{
+    gl_uncaptured_ProgramUniform2fv(program, location, count, values);
+    if (gl_capture.file)
+        capture_program_uniform(program, location, count, 2, values);
+}
+
+static void GLAPIENTRY gl_captured_ProgramUniform3fv(GLuint program, GLint location, GLsizei count, const GLfloat *values)
+{
+    gl_uncaptured_ProgramUniform3fv(program, location, count, values);
+    if (gl_capture.file)
+        capture_program_uniform(program, location, count, 3, values);
+}
+
+static void GLAPIENTRY gl_captured_ProgramUniform4fv(GLuint program, GLint location, GLsizei count, const GLfloat *values)
+{
+    gl_uncaptured_ProgramUniform4fv(program, location, count, values);
+    if (gl_capture.file)
+        capture_program_uniform(program, location, count, 4, values);
+}
+
+static void capture_program_uniform_matrix(GLuint program, GLint location, GLsizei count, GLboolean transpose, uint8_t columns,
+                                           const GLfloat *values)
+{
+    gl_capture.record(GL_CAPTURE_PROGRAM_UNIFORM_MATRIX_FV, program, location, count, transpose, columns);
+    gl_capture.put_bytes(values, sizeof(GLfloat) * columns * columns * count);
+}
+
+static void GLAPIENTRY gl_captured_ProgramUniformMatrix3fv(GLuint program, GLint location, GLsizei count, GLboolean transpose,
+                                                           const GLfloat *values)
+{
+    gl_uncaptured_ProgramUniformMatrix3fv(program, location, count, transpose, values);
+    if (gl_capture.file)
+        capture_program_uniform_matrix(program, location, count, transpose, 3, values);
+}
+
+static void GLAPIENTRY gl_captured_ProgramUniformMatrix4fv(GLuint program, GLint location, GLsizei count, GLboolean transpose,
+                                                           const GLfloat *values)
+{
+    gl_uncaptured_ProgramUniformMatrix4fv(program, location, count, transpose, values);
+    if (gl_capture.file)
+        capture_program_uniform_matrix(program, location, count, transpose, 4, values);
+}
+
+static void GLAPIENTRY gl_captured_BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    gl_uncaptured_BindFramebuffer(target, framebuffer);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_BIND_FRAMEBUFFER, target, framebuffer);
+}
+
+static void GLAPIENTRY gl_captured_Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    gl_uncaptured_Viewport(x, y, width, height);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_VIEWPORT, x, y, width, height);
+}
+
+static void GLAPIENTRY gl_captured_ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    gl_uncaptured_ClearColor(red, green, blue, alpha);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_CLEAR_COLOR, red, green, blue, alpha);
+}
+
+static void GLAPIENTRY gl_captured_Clear(GLbitfield mask)
+{
+    gl_uncaptured_Clear(mask);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_CLEAR, mask);
+}
+
+static void GLAPIENTRY gl_captured_Enable(GLenum capability)
+{
+    gl_uncaptured_Enable(capability);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_ENABLE, capability);
+}
+
+static void GLAPIENTRY gl_captured_Disable(GLenum capability)
+{
+    gl_uncaptured_Disable(capability);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_DISABLE, capability);
+}
+
+static void GLAPIENTRY gl_captured_BlendFunc(GLenum source, GLenum destination)
+{
+    gl_uncaptured_BlendFunc(source, destination);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_BLEND_FUNC, source, destination);
+}
+
+// Indices always come from the bound element buffer, so they're an offset into it
+static void GLAPIENTRY gl_captured_DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances)
+{
+    gl_uncaptured_DrawElementsInstanced(mode, count, type, indices, instances);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_DRAW_ELEMENTS_INSTANCED, mode, count, type, (uint64_t)(uintptr_t)indices, instances);
+}
+
+static void GLAPIENTRY gl_captured_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLint base_vertex)
+{
+    gl_uncaptured_DrawElementsBaseVertex(mode, count, type, indices, base_vertex);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX, mode, count, type, (uint64_t)(uintptr_t)indices, base_vertex);
+}
+
+// Sync objects are pointers; their values serve as names
+static GLsync GLAPIENTRY gl_captured_FenceSync(GLenum condition, GLbitfield flags)
+{
+    GLsync sync = gl_uncaptured_FenceSync(condition, flags);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_FENCE_SYNC, condition, flags, (uint64_t)(uintptr_t)sync);
+    return sync;
+}
+
+// Replay waits where the capture did, so it stalls on the GPU the same way
+static GLenum GLAPIENTRY gl_captured_ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    GLenum result = gl_uncaptured_ClientWaitSync(sync, flags, timeout);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_CLIENT_WAIT_SYNC, (uint64_t)(uintptr_t)sync, flags, timeout);
+    return result;
+}
+
+static void GLAPIENTRY gl_captured_DeleteSync(GLsync sync)
+{
+    gl_uncaptured_DeleteSync(sync);
+    if (gl_capture.file)
+        gl_capture.record(GL_CAPTURE_DELETE_SYNC, (uint64_t)(uintptr_t)sync);
+}
+
+// After GLEW is initialized and gl_call_stats installed, if it is, so calls are
+// counted whether or not they're captured
+bool GLCapture::start(const char *capture_file, int width, int height)
+{
+    if (file)
+        return false;
+    file = fopen(capture_file, "wb");
+    if (!file)
+    {
+        printf("[%s:%d] Unable to write %s: %s\n", __FILE__, __LINE__, capture_file, strerror(errno));
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    path = capture_file;
+    GLCaptureHeader header = {.magic = GL_CAPTURE_MAGIC, .version = GL_CAPTURE_VERSION, .width = (uint32_t)width, .height = (uint32_t)height};
+    put(header);
+    install();
+    return true;
+}
+
+void GLCapture::install()
+{
+    if (installed)
+        return;
+#define GL_CAPTURE_INSTALL(name, pointer) \
+    gl_uncaptured_##name = pointer;      \
+    if (gl_uncaptured_##name)            \
+        pointer = gl_captured_##name;
+    GL_CAPTURE_HOOKS(GL_CAPTURE_INSTALL)
+#undef GL_CAPTURE_INSTALL
+    installed = true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout of a .glcap file written by GLCapture (main --capture) and
+// read by replay. GLCaptureHeader, then records until the end of the file,
+// each a uint8_t GLCaptureOp followed by its fields, packed, in the order the
+// capture writes them (see gl_capture.cpp). Object names, sync objects and
+// uniform locations are the ones the capturing driver handed out; replay maps
+// them onto its own. Payloads (buffer and texture data, shader sources,
+// program binaries) are stored once as a GL_CAPTURE_BLOB record the first
+// time their contents are seen and referred to by blob id afterwards, 0 being
+// no data.
+
+static const uint32_t GL_CAPTURE_MAGIC = 0x50434C47; // "GLCP"
+static const uint32_t GL_CAPTURE_VERSION = 1;
+
+struct GLCaptureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width, height; // of the framebuffer the capture drew into
+};
+
+enum GLCaptureOp : uint8_t
+{
+    GL_CAPTURE_BLOB, // uint32_t id, uint64_t size, then size bytes
+    GL_CAPTURE_END_FRAME,
+
+    GL_CAPTURE_GEN_BUFFERS,
+    GL_CAPTURE_DELETE_BUFFERS,
+    GL_CAPTURE_BIND_BUFFER,
+    GL_CAPTURE_BUFFER_DATA,
+    GL_CAPTURE_BUFFER_SUB_DATA,
+    GL_CAPTURE_MAP_BUFFER_RANGE,
+    GL_CAPTURE_UNMAP_BUFFER, // carries what was written through the mapping
+
+    GL_CAPTURE_GEN_VERTEX_ARRAYS,
+    GL_CAPTURE_DELETE_VERTEX_ARRAYS,
+    GL_CAPTURE_BIND_VERTEX_ARRAY,
+    GL_CAPTURE_VERTEX_ATTRIB_POINTER,
+    GL_CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY,
+    GL_CAPTURE_VERTEX_ATTRIB_DIVISOR,
+
+    GL_CAPTURE_GEN_TEXTURES,
+    GL_CAPTURE_DELETE_TEXTURES,
+    GL_CAPTURE_ACTIVE_TEXTURE,
+    GL_CAPTURE_BIND_TEXTURE,
+    GL_CAPTURE_TEX_IMAGE_2D,
+    GL_CAPTURE_COMPRESSED_TEX_IMAGE_2D,
+    GL_CAPTURE_TEX_PARAMETERI,
+    GL_CAPTURE_GENERATE_MIPMAP,
+    GL_CAPTURE_PIXEL_STOREI,
+
+    GL_CAPTURE_CREATE_SHADER,
+    GL_CAPTURE_SHADER_SOURCE,
+    GL_CAPTURE_COMPILE_SHADER,
+    GL_CAPTURE_DELETE_SHADER,
+    GL_CAPTURE_CREATE_PROGRAM,
+    GL_CAPTURE_ATTACH_SHADER,
+    GL_CAPTURE_PROGRAM_PARAMETERI,
+    GL_CAPTURE_LINK_PROGRAM,
+    GL_CAPTURE_PROGRAM_BINARY,
+    GL_CAPTURE_DELETE_PROGRAM,
+    GL_CAPTURE_USE_PROGRAM,
+    GL_CAPTURE_GET_UNIFORM_LOCATION,
+    GL_CAPTURE_PROGRAM_UNIFORM_1I,
+    GL_CAPTURE_PROGRAM_UNIFORM_1F,
+    GL_CAPTURE_PROGRAM_UNIFORM_FV, // 2fv, 3fv and 4fv: uint8_t components
+    GL_CAPTURE_PROGRAM_UNIFORM_MATRIX_FV, // 3fv and 4fv: uint8_t columns
+
+    GL_CAPTURE_BIND_FRAMEBUFFER,
+    GL_CAPTURE_VIEWPORT,
+    GL_CAPTURE_CLEAR_COLOR,
+    GL_CAPTURE_CLEAR,
+    GL_CAPTURE_ENABLE,
+    GL_CAPTURE_DISABLE,
+    GL_CAPTURE_BLEND_FUNC,
+    GL_CAPTURE_DRAW_ELEMENTS_INSTANCED,
+    GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX,
+
+    GL_CAPTURE_FENCE_SYNC,
+    GL_CAPTURE_CLIENT_WAIT_SYNC,
+    GL_CAPTURE_DELETE_SYNC,
+
+    GL_CAPTURE_OP_COUNT
+};
@@ -0,0 +1,187 @@
+#include <GL/glew.h>
+#include <vector>
+
+// Shadows the GL binding state we touch every draw and drops calls that
+// would not change anything. All binds of programs, VAOs, array/element/
+// pixel-unpack buffers, 2D textures and blend state should go through
+// gl_state so the shadow stays correct; call invalidate() after any code
+// that bypasses it.
+struct GLStateCache
+{
+    static constexpr GLuint UNKNOWN = ~0u;
+    static constexpr int MAX_TEXTURE_UNITS = 32;
+
+    GLuint program;
+    GLuint vertex_array;
+    GLuint array_buffer;
+    GLuint pixel_unpack_buffer;
+    std::vector<GLuint> element_buffers; // element buffer binding is VAO state, indexed by VAO
+    GLenum active_unit;
+    GLuint textures[MAX_TEXTURE_UNITS];
+    int blend; // -1 unknown
+    GLenum blend_src, blend_dst;
+
+    unsigned long long calls_issued = 0;
+    unsigned long long calls_skipped = 0;
+
+    GLStateCache() { invalidate(); }
+
+    void invalidate()
+    {
+        program = UNKNOWN;
+        vertex_array = UNKNOWN;
+        array_buffer = UNKNOWN;
+        pixel_unpack_buffer = UNKNOWN;
+        element_buffers.clear();
+        active_unit = UNKNOWN;
+        for (auto &texture : textures)
+            texture = UNKNOWN;
+        blend = -1;
+        blend_src = blend_dst = UNKNOWN;
+    }
+
+    void reset_stats()
+    {
+        calls_issued = 0;
+        calls_skipped = 0;
+    }
+
+    // true when the call has to be issued
+    bool update(GLuint &shadow, GLuint value)
+    {
+        if (shadow == value)
+        {
+            calls_skipped++;
+            return false;
+        }
+        shadow = value;
+        calls_issued++;
+        return true;
+    }
+
+    void use_program(GLuint id)
+    {
+        if (update(program, id))
+            glUseProgram(id);
+    }
+
+    void bind_vertex_array(GLuint id)
+    {
+        if (update(vertex_array, id))
+            glBindVertexArray(id);
+    }
+
+    GLuint &element_buffer_of(GLuint vao)
+    {
+        if (vao >= element_buffers.size())
+            element_buffers.resize(vao + 1, UNKNOWN);
+        return element_buffers[vao];
+    }
+
+    void bind_buffer(GLenum target, GLuint id)
+    {
+        GLuint *shadow = nullptr;
+        if (target == GL_ARRAY_BUFFER)
+            shadow = &array_buffer;
+        else if (target == GL_PIXEL_UNPACK_BUFFER)
+            shadow = &pixel_unpack_buffer;
+        else if (target == GL_ELEMENT_ARRAY_BUFFER && vertex_array != UNKNOWN)
+            shadow = &element_buffer_of(vertex_array);
+
+        if (!shadow)
+        {
+            calls_issued++;
+            glBindBuffer(target, id);
+        }
+        else if (update(*shadow, id))
+        {
+            glBindBuffer(target, id);
+        }
+    }
+
+    void active_texture(GLenum unit) // GL_TEXTURE0 + n
+    {
+        if (update(active_unit, unit))
+            glActiveTexture(unit);
+    }
+
+    // Binds a 2D texture to the currently active unit
+    void bind_texture(GLuint id)
+    {
+        GLuint index = active_unit - GL_TEXTURE0;
+        if (active_unit == UNKNOWN || index >= MAX_TEXTURE_UNITS)
+        {
+            calls_issued++;
+            glBindTexture(GL_TEXTURE_2D, id);
+            return;
+        }
+        if (update(textures[index], id))
+            glBindTexture(GL_TEXTURE_2D, id);
+    }
+
+    void bind_texture(GLenum unit, GLuint id)
+    {
+        active_texture(unit);
+        bind_texture(id);
+    }
+
+    void set_blend(bool enabled)
+    {
+        if (blend == (int)enabled)
+        {
+            calls_skipped++;
+            return;
+        }
+        blend = enabled;
+        calls_issued++;
+        if (enabled)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+    }
+
+    void blend_func(GLenum src, GLenum dst)
+    {
+        if (blend_src == src && blend_dst == dst)
+        {
+            calls_skipped++;
+            return;
+        }
+        blend_src = src;
+        blend_dst = dst;
+        calls_issued++;
+        glBlendFunc(src, dst);
+    }
+
+    // GL unbinds deleted objects and may hand their names out again, so the shadow must forget them
+    void delete_texture(GLuint id)
+    {
+        for (auto &texture : textures)
+            if (texture == id)
+                texture = 0;
+        glDeleteTextures(1, &id);
+    }
+
+    void delete_buffer(GLuint id)
+    {
+        if (array_buffer == id)
+            array_buffer = 0;
+        if (pixel_unpack_buffer == id)
+            pixel_unpack_buffer = 0;
+        // Deleting unbinds it from the bound VAO only; other VAOs keep the
+        // deleted buffer attached, and the name may come back for a new one
+        for (GLuint vao = 0; vao < element_buffers.size(); vao++)
+            if (element_buffers[vao] == id)
+                element_buffers[vao] = vao == vertex_array ? 0 : UNKNOWN;
+        glDeleteBuffers(1, &id);
+    }
+
+    void delete_program(GLuint id)
+    {
+        if (program == id)
+            program = UNKNOWN; // a bound program stays in use until replaced
+        glDeleteProgram(id);
+    }
+};
+
+GLStateCache gl_state;
@@ -0,0 +1,133 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+// GPU time of parts of a frame, from GL_TIMESTAMP queries:
+//
+//     GPU_ZONE(gpu_profiler, "clear");
+//
+// A frame's queries are read back FRAME_LATENCY frames later, by which time
+// the GPU has long finished them, so reading never stalls the pipeline; a
+// frame whose results still aren't in is dropped rather than waited for.
+// Zones go to the CPU profiler's trace on a "GPU" track, shifted onto the CPU
+// clock, and the span of each frame's zones feeds the GPU time per frame.
+// Timer queries are core since GL 3.3 and llvmpipe implements them, so this
+// works headless too.
+struct GpuProfiler
+{
+    static const int FRAME_LATENCY = 4;
+    static const int MAX_ZONES = 32; // per frame; further zones aren't timed
+    static const int CALIBRATE_FRAMES = 256;
+
+    struct Frame
+    {
+        GLuint queries[2 * MAX_ZONES]; // begin and end timestamp per zone
+        const char *names[MAX_ZONES];
+        int zone_count = 0;
+    };
+
+    Frame frames[FRAME_LATENCY];
+    uint64_t frame_index = 0;
+    int64_t gpu_to_cpu_ns = 0;
+    Profiler::Ring *timeline = nullptr;
+
+    uint64_t frames_measured = 0;
+    uint64_t frames_dropped = 0;
+    double gpu_seconds = 0;
+
+    void init()
+    {
+        for (Frame &frame : frames)
+            glGenQueries(2 * MAX_ZONES, frame.queries);
+        calibrate();
+    }
+
+    // Pairs the GPU clock with the CPU one. Both drift, so this is redone now and then.
+    void calibrate()
+    {
+        GLint64 gpu_ns = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+        gpu_to_cpu_ns = (int64_t)Profiler::now_ns() - gpu_ns;
+    }
+
+    void begin_frame()
+    {
+        Frame &frame = frames[frame_index % FRAME_LATENCY];
+        if (frame.zone_count)
+            collect(frame);
+        frame.zone_count = 0;
+        if (frame_index % CALIBRATE_FRAMES == 0)
+            calibrate();
+    }
+
+    void end_frame()
+    {
+        frame_index++;
+    }
+
+    // Returns the zone to pass to end(), -1 when the frame is full
+    int begin(const char *name)
+    {
+        Frame &frame = frames[frame_index % FRAME_LATENCY];
+        if (frame.zone_count == MAX_ZONES)
+            return -1;
+        int zone = frame.zone_count++;
+        frame.names[zone] = name;
+        glQueryCounter(frame.queries[2 * zone], GL_TIMESTAMP);
+        return zone;
+    }
+
+    void end(int zone)
+    {
+        if (zone >= 0)
+            glQueryCounter(frames[frame_index % FRAME_LATENCY].queries[2 * zone + 1], GL_TIMESTAMP);
+    }
+
+    void collect(const Frame &frame)
+    {
+        // Queries complete in order, so the last one being ready means they all are
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[2 * frame.zone_count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            frames_dropped++;
+            return;
+        }
+
+        uint64_t first_ns = UINT64_MAX, last_ns = 0;
+        bool trace = profiler.enabled.load(std::memory_order_relaxed);
+        if (trace && !timeline)
+            timeline = profiler.add_ring("GPU");
+        for (int zone = 0; zone < frame.zone_count; zone++)
+        {
+            GLuint64 begin_ns = 0, end_ns = 0;
+            glGetQueryObjectui64v(frame.queries[2 * zone], GL_QUERY_RESULT, &begin_ns);
+            glGetQueryObjectui64v(frame.queries[2 * zone + 1], GL_QUERY_RESULT, &end_ns);
+            first_ns = std::min<uint64_t>(first_ns, begin_ns);
+            last_ns = std::max<uint64_t>(last_ns, end_ns);
+            if (trace)
+                profiler.record(timeline, frame.names[zone], begin_ns + gpu_to_cpu_ns, end_ns + gpu_to_cpu_ns);
+        }
+        gpu_seconds += (last_ns - first_ns) * 1e-9;
+        frames_measured++;
+    }
+};
+
+struct GpuZone
+{
+    GpuProfiler &gpu_profiler;
+    int zone;
+
+    GpuZone(GpuProfiler &gpu_profiler, const char *name)
+        : gpu_profiler(gpu_profiler), zone(gpu_profiler.begin(name))
+    {
+    }
+
+    ~GpuZone()
+    {
+        gpu_profiler.end(zone);
+    }
+};
+
+#define GPU_ZONE(gpu_profiler, name) GpuZone PROFILE_CONCAT(gpu_zone_, __LINE__)(gpu_profiler, name)
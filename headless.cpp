@@ -0,0 +1,147 @@
+#include <GL/glew.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// An OpenGL 4.1 core context with no window, for benchmark and CI machines
+// without a display or GPU. On Linux it is an EGL context on Mesa's
+// surfaceless platform (llvmpipe when there is no GPU) drawing into an FBO
+// the size a window would have been; link with -lEGL. Elsewhere init() fails.
+struct HeadlessContext
+{
+    int width = 800;
+    int height = 600;
+
+    GLuint FBO = 0;
+    GLuint color_RBO = 0;
+    GLuint depth_stencil_RBO = 0;
+
+#ifdef __linux__
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+
+    bool init()
+    {
+        auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display)
+            display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major, minor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            printf("[%s:%d] Unable to initialize EGL: 0x%x\n", __FILE__, __LINE__, eglGetError());
+            return false;
+        }
+
+        // No surface: the context is made current without one and renders into the FBO.
+        // Surface type defaults to window, which surfaceless configs don't have.
+        const EGLint config_attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config;
+        EGLint config_count = 0;
+        if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || !config_count || !eglBindAPI(EGL_OPENGL_API))
+        {
+            printf("[%s:%d] No EGL config for desktop OpenGL: 0x%x\n", __FILE__, __LINE__, eglGetError());
+            return false;
+        }
+        const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 1,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE,
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            printf("[%s:%d] Unable to create an OpenGL 4.1 core context: 0x%x\n", __FILE__, __LINE__, eglGetError());
+            return false;
+        }
+
+        // glewInit() looks for GLX and fails without an X display; this skips that
+        glewExperimental = GL_TRUE;
+        if (glewContextInit() != GLEW_OK)
+        {
+            printf("[%s:%d] Failed to initialize GLEW\n", __FILE__, __LINE__);
+            return false;
+        }
+        return create_framebuffer();
+    }
+
+    void destroy()
+    {
+        if (FBO)
+        {
+            glDeleteFramebuffers(1, &FBO);
+            glDeleteRenderbuffers(1, &color_RBO);
+            glDeleteRenderbuffers(1, &depth_stencil_RBO);
+            FBO = 0;
+        }
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (context != EGL_NO_CONTEXT)
+                eglDestroyContext(display, context);
+            eglTerminate(display);
+        }
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+    }
+#else
+    bool init()
+    {
+        printf("[%s:%d] Headless mode needs EGL, which this platform doesn't have\n", __FILE__, __LINE__);
+        return false;
+    }
+
+    void destroy() {}
+#endif
+
+    // Stays bound for the whole run: nothing else binds a framebuffer
+    bool create_framebuffer()
+    {
+        glGenRenderbuffers(1, &color_RBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, color_RBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glGenRenderbuffers(1, &depth_stencil_RBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_stencil_RBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_RBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_stencil_RBO);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            printf("[%s:%d] Incomplete framebuffer: 0x%x\n", __FILE__, __LINE__, status);
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+    }
+};
+
+// Writes the bound framebuffer's color buffer as a binary PPM, top row first
+bool save_framebuffer_ppm(const char *file, int width, int height)
+{
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    FILE *out = fopen(file, "wb");
+    if (!out)
+    {
+        printf("[%s:%d] Unable to write %s: %s\n", __FILE__, __LINE__, file, strerror(errno));
+        return false;
+    }
+    fprintf(out, "P6\n%d %d\n255\n", width, height);
+    for (int y = height - 1; y >= 0; y--)
+        fwrite(pixels.data() + (size_t)y * width * 3, 1, (size_t)width * 3, out);
+    fclose(out);
+    return true;
+}
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobCounter;
+
+// A function over the index range [begin, end). Plain function pointers so
+// the game library can hand work to the host's threads.
+struct Job
+{
+    void (*function)(void *data, uint32_t begin, uint32_t end);
+    void *data;
+    uint32_t begin, end;
+    JobCounter *counter; // decremented when the job has run, may be NULL
+};
+
+// Counts unfinished jobs. JobSystem::wait() returns once it reaches zero, and
+// a continuation added with JobSystem::then() is submitted at that moment.
+struct JobCounter
+{
+    std::atomic<int> pending{0};
+    Job continuation = {};
+};
+
+// Chase-Lev deque: the owning thread pushes and pops at the bottom, other
+// threads steal from the top. Holds pointers into the owner's job ring; a
+// taken job is copied out before it leaves the deque, since the owner may
+// reuse its slot as soon as it has.
+struct WorkStealingDeque
+{
+    static const int64_t CAPACITY = 4096; // power of two
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+    std::atomic<Job *> jobs[CAPACITY];
+
+    bool push(Job *job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+            return false;
+        jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool full() const
+    {
+        return bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_acquire) >= CAPACITY;
+    }
+
+    bool pop(Job &out)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        out = *jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        bool taken = true;
+        if (t == b)
+        {
+            // Last job: race the thieves for it
+            taken = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return taken;
+    }
+
+    bool steal(Job &out)
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        // Copied before the CAS: once top moves past it the owner may refill the slot.
+        // A copy torn by that is thrown away, because then the CAS fails.
+        out = *jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+// Work-stealing scheduler. The thread that calls start() becomes worker 0
+// and the others are spawned; each has its own deque and job ring, takes its
+// newest job first and steals the oldest from a random victim when it runs
+// dry. Waiting never blocks a worker: wait() runs other jobs until the
+// counter drains, so jobs can wait on jobs. Idle workers sleep on a
+// condition variable rather than spin.
+//
+// run() is for workers only; from any other thread the job runs inline.
+// run_background() is for work nobody waits on soon (texture decodes): it
+// goes to a shared queue that worker 0, the GL thread, never takes from, so
+// it can't land in the middle of a frame through help().
+struct JobSystem
+{
+    struct Worker
+    {
+        WorkStealingDeque deque;
+        Job ring[WorkStealingDeque::CAPACITY]; // storage for the jobs in deque, at the same index
+        uint32_t random_state;
+    };
+
+    std::vector<Worker *> workers;
+    MPMCQueue<Job> background; // taken by every worker but 0
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping{false};
+    std::atomic<int> queued{0}; // pushed and not yet taken
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<int> sleeping{0}; // changed under sleep_mutex
+
+    static thread_local int worker_index; // -1 outside the pool
+
+    ~JobSystem() { stop(); }
+
+    bool running() const
+    {
+        return !workers.empty();
+    }
+
+    unsigned int thread_count() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    void start(unsigned int count = 0)
+    {
+        if (running())
+            return;
+        // At least one thread besides the caller, or jobs it queues and doesn't
+        // wait on (texture decodes) would never run
+        if (!count)
+            count = std::thread::hardware_concurrency();
+        count = std::max(2u, count);
+        stopping = false;
+        background.init(1024);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            workers.push_back(new Worker);
+            workers.back()->random_state = 0x9E3779B9u * (i + 1);
+        }
+        worker_index = 0;
+        for (unsigned int i = 1; i < count; i++)
+            threads.emplace_back([this, i] { worker_main((int)i); });
+    }
+
+    // Runs whatever is still queued, then joins the threads
+    void stop()
+    {
+        if (!running())
+            return;
+        Job job;
+        while (find_job(worker_index >= 0 ? worker_index : 0, job) || take_background(job))
+            execute(job);
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+        threads.clear();
+        for (Worker *worker : workers)
+            delete worker;
+        workers.clear();
+        worker_index = -1;
+    }
+
+    void run(const Job &job)
+    {
+        if (job.counter)
+            job.counter->pending++;
+        submit(job);
+    }
+
+    // Like run(), but only ever picked up by a worker other than 0. Runs inline
+    // when the pool isn't running or the queue is full.
+    void run_background(const Job &job)
+    {
+        if (job.counter)
+            job.counter->pending++;
+        if (!running() || !background.push(job))
+        {
+            execute(job);
+            return;
+        }
+        queued++;
+        notify();
+    }
+
+    // Submits job once counter drains. Call before adding jobs to counter;
+    // waiting on job.counter then covers the whole chain.
+    void then(JobCounter *counter, const Job &job)
+    {
+        if (job.counter)
+            job.counter->pending++;
+        counter->continuation = job;
+    }
+
+    // Calls function(data, begin, end) over [0, count) split into batches of at
+    // least min_batch and returns when all of them are done. The calling
+    // thread takes the first batch itself.
+    void parallel_for(uint32_t count, uint32_t min_batch, void (*function)(void *, uint32_t, uint32_t), void *data)
+    {
+        if (!count)
+            return;
+        min_batch = std::max(1u, min_batch);
+        uint32_t batches = std::min((count + min_batch - 1) / min_batch, thread_count() * 4);
+        if (batches <= 1 || worker_index < 0)
+        {
+            function(data, 0, count);
+            return;
+        }
+        uint32_t batch = (count + batches - 1) / batches;
+        JobCounter counter;
+        for (uint32_t begin = batch; begin < count; begin += batch)
+            run({function, data, begin, std::min(begin + batch, count), &counter});
+        function(data, 0, batch);
+        wait(&counter);
+    }
+
+    // Runs other jobs until counter reaches zero
+    void wait(JobCounter *counter)
+    {
+        while (counter->pending.load(std::memory_order_acquire) > 0)
+            if (!help())
+                std::this_thread::yield();
+    }
+
+    // Runs one queued job on the calling worker; false if there was none
+    bool help()
+    {
+        Job job;
+        if (worker_index < 0 || !find_job(worker_index, job))
+            return false;
+        execute(job);
+        return true;
+    }
+
+    void submit(const Job &job)
+    {
+        // Full: no room to defer it. Checked before filling the ring slot, which
+        // would still hold a queued job.
+        if (worker_index < 0 || workers[worker_index]->deque.full())
+        {
+            execute(job);
+            return;
+        }
+        Worker *worker = workers[worker_index];
+        // The slot of the deque position it's pushed at: only reused once the
+        // job before it there has left the deque
+        Job *slot = &worker->ring[worker->deque.bottom.load(std::memory_order_relaxed) & (WorkStealingDeque::CAPACITY - 1)];
+        *slot = job;
+        worker->deque.push(slot);
+        queued++;
+        notify();
+    }
+
+    void notify()
+    {
+        // Sleepers bump sleeping before checking queued, so one side always sees the other
+        if (sleeping > 0)
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            wake.notify_one();
+        }
+    }
+
+    bool take_background(Job &job)
+    {
+        if (!background.pop(job))
+            return false;
+        queued--;
+        return true;
+    }
+
+    bool find_job(int index, Job &job)
+    {
+        Worker *self = workers[index];
+        bool found = self->deque.pop(job);
+        if (!found && workers.size() > 1)
+        {
+            // xorshift32 picks where to start looking
+            uint32_t x = self->random_state;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            self->random_state = x;
+            for (size_t i = 0; i < workers.size() && !found; i++)
+            {
+                size_t victim = (x + i) % workers.size();
+                if ((int)victim != index)
+                    found = workers[victim]->deque.steal(job);
+            }
+        }
+        if (found)
+            queued--;
+        else if (index != 0)
+            found = take_background(job);
+        return found;
+    }
+
+    void execute(const Job &job)
+    {
+        PROFILE_ZONE("job");
+        job.function(job.data, job.begin, job.end);
+        if (!job.counter)
+            return;
+        // Read before the decrement: once pending hits zero a waiter may free the counter
+        Job continuation = job.counter->continuation;
+        if (job.counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1 && continuation.function)
+            submit(continuation);
+    }
+
+    void worker_main(int index)
+    {
+        worker_index = index;
+        Profiler::set_thread_name("job worker");
+        int idle_spins = 0;
+        while (!stopping)
+        {
+            Job job;
+            if (find_job(index, job))
+            {
+                execute(job);
+                idle_spins = 0;
+                continue;
+            }
+            if (++idle_spins < 64)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleeping++;
+            wake.wait(lock, [this] { return stopping || queued > 0; });
+            sleeping--;
+            idle_spins = 0;
+        }
+        worker_index = -1;
+    }
+};
+
+thread_local int JobSystem::worker_index = -1;
+
+JobSystem job_system;
@@ -0,0 +1,75 @@
+#include <cstdio>
+
+#include "profiler.cpp"
+#include "mpmc_queue.cpp"
+#include "job_system.cpp"
+
+// Checks that a job stays intact in its worker's deque while more than
+// WorkStealingDeque::CAPACITY others are pushed and popped past it. Exits
+// non-zero on failure.
+
+static std::atomic<bool> busy_started{false};
+static std::atomic<bool> busy_release{false};
+static std::atomic<int> held_runs{0};
+static std::atomic<int> batch_runs[8];
+
+static void busy_job(void *, uint32_t, uint32_t)
+{
+    busy_started = true;
+    while (!busy_release)
+        std::this_thread::yield();
+}
+
+static void held_job(void *, uint32_t, uint32_t)
+{
+    held_runs++;
+}
+
+static void batch_job(void *, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+        batch_runs[i]++;
+}
+
+int main()
+{
+    int failures = 0;
+    job_system.start(2); // this thread is worker 0
+
+    // Keep worker 1 out of the way, so nothing steals the held job. Not
+    // helping meanwhile: this thread would pop the busy job itself.
+    JobCounter busy;
+    job_system.run({busy_job, nullptr, 0, 1, &busy});
+    while (!busy_started)
+        std::this_thread::yield();
+
+    // Each parallel_for pushes 7 batches on top of the held job and pops them
+    // again; 600 of them go round the deque more than once
+    JobCounter held;
+    job_system.run({held_job, nullptr, 0, 1, &held});
+    const int rounds = 600;
+    for (int i = 0; i < rounds; i++)
+        job_system.parallel_for(8, 1, batch_job, nullptr);
+    while (job_system.help())
+        ;
+
+    if (held_runs != 1 || held.pending != 0)
+    {
+        printf("[%s:%d] Held job ran %d times, %d still pending\n", __FILE__, __LINE__, held_runs.load(), held.pending.load());
+        failures++;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        if (batch_runs[i] != rounds)
+        {
+            printf("[%s:%d] Batch index %d ran %d times instead of %d\n", __FILE__, __LINE__, i, batch_runs[i].load(), rounds);
+            failures++;
+        }
+    }
+
+    busy_release = true;
+    job_system.wait(&busy);
+    job_system.stop();
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
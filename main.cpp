@@ -1,224 +1,231 @@
 #include <GL/glew.h>
-#include <GLFW/glfw3.h>
 #include <iostream>
 #include <cstdlib>
 #include <vector>
 
+#include "gl_call_stats.cpp" // first: reroutes GL 1.1 calls in everything after it
+#include "gl_capture.cpp"
+#include "profiler.cpp"
+#include "gl_state_cache.cpp"
+#include "gpu_profiler.cpp"
+#include "file_data.cpp"
+#include "mpmc_queue.cpp"
+#include "job_system.cpp"
 #include "shader.cpp"
+#include "stream_buffer.cpp"
+#include "sprite_batch.cpp"
+#include "render_commands.cpp"
+#include "fixed_timestep.cpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-// Error callback for GLFW
-void errorCallback(int error, const char *description)
-{
-    std::cerr << "GLFW Error: " << description << std::endl;
-}
+#include "texture_loader.cpp"
+#include "texture_atlas.cpp"
+#include "file_watcher.cpp"
+#include "headless.cpp"
+#include "window.cpp"
 
 
 //--------[ DLL ]--------------------------------------------
 #include <dlfcn.h>
-#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
 #include <string>
 
+#include "game.h"
+
+#define GAME_LIBRARY "libgame.dylib"
+#define GAME_LOCK_FILE "lock.tmp" // exists while the build task is writing GAME_LIBRARY
+
 typedef struct
 {
     void* game_code_handle;
-    time_t dll_last_write_time;
-    void (*clear_color)(float *, float *, float *, float *);
+    game_init_fn *init;
+    game_update_fn *update;
+    game_render_fn *render;
+
+    unsigned int load_count;
+    bool reload_pending; // GAME_LIBRARY changed and hasn't been loaded yet
+    std::chrono::steady_clock::time_point change_seen;
+    double load_ms, max_load_ms;
 } GameCode;
 
-time_t get_last_write_time(const char *filename)
+// Plain read/write rather than FileData: a mapping of a file the compiler is
+// still writing can fault if it shrinks underneath us
+bool copy_file(const char *from, const char *to)
 {
-    time_t last_write_time = 0;
-    struct stat stat_data = {};
-    if (stat(filename, &stat_data) == 0)
+    int source = open(from, O_RDONLY | O_CLOEXEC);
+    if (source == -1)
+    {
+        printf("[%s:%d] Unable to open %s: %s\n", __FILE__, __LINE__, from, strerror(errno));
+        return false;
+    }
+    int destination = open(to, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+    if (destination == -1)
+    {
+        printf("[%s:%d] Unable to create %s: %s\n", __FILE__, __LINE__, to, strerror(errno));
+        close(source);
+        return false;
+    }
+    char buffer[64 * 1024];
+    ssize_t count;
+    bool ok = true;
+    while (ok && (count = read(source, buffer, sizeof(buffer))) != 0)
     {
-        last_write_time = stat_data.st_mtime;
+        ok = count > 0;
+        for (ssize_t written = 0; ok && written < count;)
+        {
+            ssize_t n = write(destination, buffer + written, (size_t)(count - written));
+            ok = n > 0;
+            written += n;
+        }
     }
-    return (last_write_time);
+    if (!ok)
+        printf("[%s:%d] Unable to copy %s: %s\n", __FILE__, __LINE__, from, strerror(errno));
+    close(source);
+    if (close(destination) != 0 || !ok)
+    {
+        unlink(to);
+        return false;
+    }
+    return true;
 }
 
-void load_game_code(GameCode *game_code)
+// Loads a uniquely named copy of GAME_LIBRARY so the build can overwrite the
+// original at any time and the loader never hands back a cached handle. The
+// previous library is only closed once the new one resolved every entry
+// point; on failure game_code is left untouched and keeps running.
+bool load_game_code(GameCode *game_code)
 {
-    void *lib_handle = dlopen("libgame.dylib", RTLD_NOW);
+    auto start = std::chrono::steady_clock::now();
+
+    char shadow_file[64];
+    snprintf(shadow_file, sizeof(shadow_file), "./libgame_%d_%u.dylib", (int)getpid(), game_code->load_count);
+    if (!copy_file(GAME_LIBRARY, shadow_file))
+        return false;
+    void *lib_handle = dlopen(shadow_file, RTLD_NOW | RTLD_LOCAL);
+    unlink(shadow_file); // stays mapped while open, nothing to clean up on exit
     if (!lib_handle)
     {
         printf("[%s:%d] Unable to load library: %s\n", __FILE__,__LINE__, dlerror());
-        exit(EXIT_FAILURE);
+        return false;
     }
-    game_code->game_code_handle = lib_handle;
-    game_code->clear_color = (void (*)(float*, float*, float*, float*))dlsym(lib_handle, "clear_color");
-    if (!game_code->clear_color)
+
+    GameCode loaded = *game_code;
+    loaded.game_code_handle = lib_handle;
+    loaded.init = (game_init_fn *)dlsym(lib_handle, "game_init");
+    loaded.update = (game_update_fn *)dlsym(lib_handle, "game_update");
+    loaded.render = (game_render_fn *)dlsym(lib_handle, "game_render");
+    if (!loaded.init || !loaded.update || !loaded.render)
     {
         printf("[%s:%d] Unable to get symbol: %s\n", __FILE__,__LINE__, dlerror());
+        dlclose(lib_handle);
+        return false;
+    }
+
+    if (game_code->game_code_handle)
+        dlclose(game_code->game_code_handle);
+    loaded.load_count++;
+    loaded.load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    loaded.max_load_ms = std::max(loaded.max_load_ms, loaded.load_ms);
+    *game_code = loaded;
+    return true;
+}
+
+// Reserves the game's memory once, at the same address every run, so a
+// snapshot of it stays meaningful. Pages are only committed when touched.
+GameMemory allocate_game_memory(size_t size)
+{
+    void *base_address = (void *)(2ull << 40); // 2 TB, far from the heap and libraries
+    void *storage = mmap(base_address, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        printf("[%s:%d] Unable to allocate game memory: %s\n", __FILE__, __LINE__, strerror(errno));
         exit(EXIT_FAILURE);
     }
-    game_code->dll_last_write_time = get_last_write_time("libgame.dylib");
+    if (storage != base_address)
+        printf("[%s:%d] Game memory is at %p instead of %p\n", __FILE__, __LINE__, storage, base_address);
+    return {storage, size, nullptr};
 }
 
-struct Quad
-{    
-    Shader shader;
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<unsigned int> textures;
+// Handed to the game through GameMemory
+void job_parallel_for(uint32_t count, uint32_t min_batch, void (*function)(void *, uint32_t, uint32_t), void *data)
+{
+    job_system.parallel_for(count, min_batch, function, data);
+}
+
+// The game only records from the main thread and its parallel_for jobs, all job_system workers
+uint32_t job_thread_index()
+{
+    return (uint32_t)std::max(0, JobSystem::worker_index);
+}
 
-    GLuint VAO;
-    GLuint VBO;
-    GLuint EBO;
-    bool dynamic = false;
+// Seconds since some fixed point; glfwGetTime() needs GLFW, which headless runs don't start
+double now_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    void upload_vertices()
+int main(int argc, char **argv)
+{
+    bool headless = false;
+    uint64_t frame_limit = 0; // 0: until the window is closed
+    const char *output_file = nullptr;
+    const char *trace_file = nullptr;
+    bool count_gl_calls = false;
+    const char *capture_file = nullptr;
+    for (int i = 1; i < argc; i++)
     {
-        // Create Vertex Array Object
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-
-        // Create Vertex Buffer Object
-        glGenBuffers(1, &VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertices.size() * sizeof(vertices.front()), vertices.data(), dynamic?GL_DYNAMIC_DRAW:GL_STATIC_DRAW);
-
-        glGenBuffers(1, &EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indices.size() * sizeof(indices.front()), indices.data(), dynamic?GL_DYNAMIC_DRAW:GL_STATIC_DRAW);
-
-        // Set vertex attribute pointers
-        // Position attribute
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(0);
-        // Color attribute
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        // UV attribute
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        // Unbind VAO
-        glBindVertexArray(0);
-    }
-    void upload_texture(const char *texture_file)
-    {    
-        unsigned int texture_id;
-        stbi_set_flip_vertically_on_load(true);
-        int img_width, img_height, img_nr_channels;
-        uint8_t *data = stbi_load(texture_file, &img_width, &img_height, &img_nr_channels, 0);
-        
-        if (!data) {
-            std::cerr << "Failed to load texture: " << texture_file << std::endl;
-            return;
-        }
-    
-        glGenTextures(1, &texture_id);
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-    
-        // set the texture wrapping/filtering options (on the currently bound texture object)
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        
-        // Choose the correct format based on channels
-        GLint format;
-        if (img_nr_channels == 1)
-            format = GL_RED;
-        else if (img_nr_channels == 3)
-            format = GL_RGB;
-        else if (img_nr_channels == 4)
-            format = GL_RGBA;
-        else {
-            std::cerr << "Unsupported image format" << std::endl;
-            stbi_image_free(data);
-            return;
+        if (!strcmp(argv[i], "--headless"))
+            headless = true;
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            frame_limit = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+            output_file = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            trace_file = argv[++i];
+        else if (!strcmp(argv[i], "--gl-stats"))
+            count_gl_calls = true;
+        else if (!strcmp(argv[i], "--capture") && i + 1 < argc)
+            capture_file = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--headless] [--frames N] [--output last_frame.ppm] [--trace trace.json] [--gl-stats] [--capture frames.glcap]\n", argv[0]);
+            return -1;
         }
-    
-        glTexImage2D(GL_TEXTURE_2D, 0, format, img_width, img_height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    
-        stbi_image_free(data);
-    
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        // Get the texture unit index
-        auto texture_unit = textures.size();
-        
-        // Activate the correct texture unit
-        glActiveTexture(GL_TEXTURE0 + texture_unit);
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-
-        std::string texture_name = "texture_" + std::to_string(texture_unit);
-        shader.set_int(texture_name, (int)texture_unit);
-        textures.push_back(texture_id);
     }
- 
-    void draw()
+    if (headless && !frame_limit)
+        frame_limit = 600;
+    Profiler::set_thread_name("main");
+    profiler.enabled = trace_file != nullptr; // before anything worth timing, shader compiles included
+
+    Window window;
+    HeadlessContext headless_context;
+    if (headless)
     {
-        shader.use();
-        glBindVertexArray(VAO);
-        if (dynamic)
-        { 
-            glBindVertexArray(VBO);
-            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertices.size() * sizeof(vertices.front()), vertices.data(), GL_STATIC_DRAW);
-        }
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
- 
-        unsigned int tex_pos = GL_TEXTURE0;
-        for (auto texture: textures)
+        // Same scene, drawn into an FBO; no window, input or vsync
+        if (!headless_context.init())
         {
-            glActiveTexture(tex_pos++);
-            glBindTexture(GL_TEXTURE_2D, texture);
-        }       
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        // Unbind VAO
-        glBindVertexArray(0);
- 
+            headless_context.destroy();
+            return -1;
+        }
     }
-};
-
-int main()
-{
-    // Initialize GLFW
-    if (!glfwInit())
+    else if (!window.init(800, 600, "OpenGL 4.1 Colored Triangle"))
     {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
 
-    // Set error callback
-    glfwSetErrorCallback(errorCallback);
-
-    // Configure GLFW to use OpenGL 4.1
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    // Create a window
-    GLFWwindow *window = glfwCreateWindow(800, 600, "OpenGL 4.1 Colored Triangle", NULL, NULL);
-    if (!window)
+    if (count_gl_calls)
+        gl_call_stats.install();
+    if (capture_file)
     {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-
-    // Make the window's context current
-    glfwMakeContextCurrent(window);
-
-    // Initialize GLEW
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK)
-    {
-        std::cerr << "Failed to initialize GLEW" << std::endl;
-        glfwDestroyWindow(window);
-        glfwTerminate();
-        return -1;
+        // Before anything is created: replay only knows the objects it saw being made
+        int width = headless_context.width, height = headless_context.height;
+        window.framebuffer_size(&width, &height);
+        gl_capture.start(capture_file, width, height);
     }
 
     // Verify OpenGL version
@@ -230,160 +237,232 @@ int main()
     std::cout << "Maximum nr of vertex attributes supported: " << nrAttributes << std::endl;
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    Quad flag = {.shader = Shader("../res/shaders/text1.vert", "../res/shaders/multi_text_quad1.frag"),
-                 .vertices = {
-                     /* pos */  0.5f,  0.5f, 0.0f, /* color */ 1.0f, 0.0f, 0.0f, /* uv */ 1, 1,   // top right
-                     /* pos */  0.5f, -0.3f, 0.0f, /* color */ 1.0f, 1.0f, 0.0f, /* uv */ 1, 0,  // bottom right
-                     /* pos */ -0.5f, -0.3f, 0.0f, /* color */ 0.0f, 0.0f, 1.0f, /* uv */ 0, 0, // bottom left
-                     /* pos */ -0.5f,  0.5f, 0.0f, /* color */ 0.0f, 1.0f, 1.0f, /* uv */ 0, 1,  // top left
-                 },
-                 .indices = {
-                     0, 1, 3, // first triangle
-                     1, 2, 3, // second triangle
-                 }};
-    flag.upload_vertices();
-    flag.upload_texture("../res/textures/us.png");
-
-
-
-    float plane_x = -1.;
-    float plane_y = .7;
-    Quad plane = {.shader = Shader("../res/shaders/text1.vert", "../res/shaders/text1.frag"),
-                  .vertices = {
-                      /* pos */ plane_x + 0.3f, plane_y + 0.3f, 0.0f, /* color */ 1.0f, 0.0f, 0.0f, /* uv */ 0, 0, // top right
-                      /* pos */ plane_x + 0.3f, plane_y + 0.0f, 0.0f, /* color */ 0.0f, 1.0f, 0.0f, /* uv */ 0, 1, // bottom right
-                      /* pos */ plane_x + 0.0f, plane_y + 0.0f, 0.0f, /* color */ 0.0f, 0.0f, 1.0f, /* uv */ 1, 1, // bottom left
-                      /* pos */ plane_x + 0.0f, plane_y + 0.3f, 0.0f, /* color */ 0.5f, 0.5f, 0.0f, /* uv */ 1, 0, // top left
-                  },
-                  .indices = {
-                      0, 1, 3, // first triangle
-                      1, 2, 3, // second triangle
-                  },
-                  .dynamic = true
-                };
-    plane.upload_vertices();
-    plane.upload_texture("../res/textures/chat_gpt_plane.png");
-
-    // Main rendering loop
-    float r = 0.2f, g = 0.3f, b = 0.3f, a = 1.0f;
+    StreamBuffer frame_stream;
+    frame_stream.init(GL_ARRAY_BUFFER, 4 * 1024 * 1024);
+
+    SpriteBatch sprite_batch = {.instanced = true, .presorted = true, .stream = &frame_stream}; // render_queue sorts
+    sprite_batch.init();
+
+    // Optional, built by atlas_packer; textures missing from it are loaded on their own
+    const char *atlas_file = "../res/textures.atlas";
+    TextureAtlas atlas;
+    atlas.load(atlas_file);
+
+    Shader flag_shader("../res/shaders/sprite_instanced.vert", "../res/shaders/multi_text_quad1.frag");
+    Shader plane_shader("../res/shaders/sprite_instanced.vert", "../res/shaders/text1.frag");
+
+    // How each GameSprite is drawn. Textures and uvs come from the atlas and
+    // are looked up again by set_sprite_textures() when it is rebuilt.
+    Shader *sprite_shaders[GAME_SPRITE_COUNT] = {&flag_shader, &plane_shader};
+    const char *sprite_files[GAME_SPRITE_COUNT] = {"../res/textures/us.png", "../res/textures/chat_gpt_plane.png"};
+    GLuint sprite_textures[GAME_SPRITE_COUNT];
+    GameAssets game_assets;
+    mat4 view_projection = mat4_ortho(-1, 1, -1, 1, -1, 1); // sprites are placed in -1..1 on both axes
+    UniformHandle view_projection_uniforms[GAME_SPRITE_COUNT];
+    for (uint32_t i = 0; i < GAME_SPRITE_COUNT; i++)
+        view_projection_uniforms[i] = sprite_shaders[i]->uniform("view_projection");
+
+    gl_state.set_blend(true);
+    gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // All game state lives here and survives reloads
+    job_system.start(); // this thread is worker 0
+    GameMemory game_memory = allocate_game_memory(64 * 1024 * 1024);
+    game_memory.parallel_for = job_parallel_for;
+    RenderQueue render_queue;
+    render_queue.init(job_system.thread_count());
+    auto set_sprite_textures = [&]()
+    {
+        for (uint32_t i = 0; i < GAME_SPRITE_COUNT; i++)
+        {
+            AtlasRegion region = atlas.region(sprite_files[i]);
+            sprite_textures[i] = region.texture;
+            game_assets.sprites[i] = region.uv;
+        }
+        for (uint32_t i = 0; i < GAME_SPRITE_COUNT; i++)
+        {
+            // Sprites sharing a shader or texture share its slot, so their draws group together
+            uint32_t shader_slot = i, texture_slot = i;
+            for (uint32_t j = 0; j < i; j++)
+            {
+                if (sprite_shaders[j] == sprite_shaders[i])
+                    shader_slot = std::min(shader_slot, j);
+                if (sprite_textures[j] == sprite_textures[i])
+                    texture_slot = std::min(texture_slot, j);
+            }
+            render_queue.set_material((GameSprite)i, shader_slot, texture_slot);
+        }
+    };
+    set_sprite_textures();
 
     GameCode game_code = {};
-    load_game_code(&game_code);
+    if (!load_game_code(&game_code))
+    {
+        window.destroy();
+        headless_context.destroy();
+        return -1;
+    }
+    game_code.init(&game_memory, &game_assets);
+
+    // Reloads the game library, shaders, textures and the atlas when they change on disk
+    FileWatcher watcher;
+    watcher.start({".", "../res", "../res/shaders", "../res/textures"});
+    std::vector<std::string> changed_files;
 
-    // Plane movement variables
-    float dx = 0.0f, dy = -0.005f;
-    int direction = 0; // 0: down, 1: right, 2: up, 3: left
+    GpuProfiler gpu_profiler;
+    gpu_profiler.init();
 
-    auto patrol_plane = [&]() -> void
+    FixedTimestep timestep;
+    double simulation_seconds = 0, render_seconds = 0;
+    uint64_t frames = 0;
+
+    // Main rendering loop
+    while (window.open() ? !window.should_close() : frames < frame_limit)
     {
-        // Update all vertices
-        for (int i = 0; i < 4; i++)
+        PROFILE_ZONE("frame");
         {
-            plane.vertices[i * 8] += dx;
-            plane.vertices[i * 8 + 1] += dy;
+            PROFILE_ZONE("reload changed files");
+            watcher.poll(changed_files);
+            bool atlas_changed = false;
+            for (auto &file : changed_files)
+            {
+                if (file == atlas_file)
+                {
+                    atlas_changed = true;
+                    continue;
+                }
+                if (file == "./" GAME_LIBRARY)
+                {
+                    if (!game_code.reload_pending)
+                        game_code.change_seen = std::chrono::steady_clock::now();
+                    game_code.reload_pending = true;
+                    continue;
+                }
+                for (uint32_t i = 0; i < GAME_SPRITE_COUNT; i++)
+                {
+                    Shader *shader = sprite_shaders[i];
+                    if (file == shader->vertex_file || file == shader->fragment_file)
+                    {
+                        shader->reload();
+                        view_projection_uniforms[i] = shader->uniform("view_projection");
+                    }
+                }
+                // A re-cooked texture is picked up by decoding its source again
+                const std::string ctex = ".ctex";
+                bool cooked = file.size() > ctex.size() && !file.compare(file.size() - ctex.size(), ctex.size(), ctex);
+                texture_loader.reload_file(cooked ? file.substr(0, file.size() - ctex.size()) : file);
+            }
+            // New pages and rects; init() hands the game its new uvs
+            if (atlas_changed)
+            {
+                atlas.unload();
+                atlas.load(atlas_file);
+                set_sprite_textures();
+                game_code.init(&game_memory, &game_assets);
+            }
+        }
+        // Waits out the build; a library that fails to load leaves the old one running
+        if (game_code.reload_pending && access(GAME_LOCK_FILE, F_OK) != 0)
+        {
+            PROFILE_ZONE("reload game code");
+            game_code.reload_pending = false;
+            if (load_game_code(&game_code))
+            {
+                game_code.init(&game_memory, &game_assets);
+                double latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - game_code.change_seen).count();
+                printf("Reloaded %s in %.2f ms (max %.2f ms), %.0f ms after the change was seen\n",
+                       GAME_LIBRARY, game_code.load_ms, game_code.max_load_ms, latency_ms);
+            }
         }
 
-        // Calculate center point for rotation
-        float cx = (plane.vertices[0] + plane.vertices[8] + plane.vertices[16]) / 3.0f;
-        float cy = (plane.vertices[1] + plane.vertices[9] + plane.vertices[17]) / 3.0f;
+        // Process input
+        if (window.escape_pressed())
+            window.close();
 
-        // Check boundaries and change direction
-        // swap UVs for turning
-        if (cy <= -0.9f && direction == 0)
         {
-            // Bottom edge - turn right
-            direction = 1;
-            dy = 0.0f;
-            dx = 0.005f;
-
-            plane.vertices[8 * 0 + 6 + 0] = 0;
-            plane.vertices[8 * 0 + 6 + 1] = 1;
-            plane.vertices[8 * 1 + 6 + 0] = 1;
-            plane.vertices[8 * 1 + 6 + 1] = 1;
-            plane.vertices[8 * 2 + 6 + 0] = 1;
-            plane.vertices[8 * 2 + 6 + 1] = 0;
-            plane.vertices[8 * 3 + 6 + 0] = 0;
-            plane.vertices[8 * 3 + 6 + 1] = 0;
+            PROFILE_ZONE("upload textures");
+            texture_loader.pump();
         }
-        else if (cx >= .9f && direction == 1)
+
+        // Headless runs advance exactly one tick per frame, so every run simulates the same thing
+        double simulation_start = now_seconds();
+        for (int steps = headless ? timestep.step() : timestep.advance(simulation_start); steps > 0; steps--)
         {
-            // Right edge - turn up
-            direction = 2;
-            dx = 0.0f;
-            dy = 0.005f;
-
-            plane.vertices[8 * 0 + 6 + 0] = 0;
-            plane.vertices[8 * 0 + 6 + 1] = 1;
-            plane.vertices[8 * 1 + 6 + 0] = 0;
-            plane.vertices[8 * 1 + 6 + 1] = 0;
-            plane.vertices[8 * 2 + 6 + 0] = 1;
-            plane.vertices[8 * 2 + 6 + 1] = 0;
-            plane.vertices[8 * 3 + 6 + 0] = 1;
-            plane.vertices[8 * 3 + 6 + 1] = 1;
+            PROFILE_ZONE("game_update");
+            game_code.update(&game_memory, (float)timestep.tick_seconds);
         }
-        else if (cy >= .8 && direction == 2)
+
+        // Rendering
+        double render_start = now_seconds();
+        simulation_seconds += render_start - simulation_start;
+        gpu_profiler.begin_frame();
+        GameRenderList render_list = render_queue.begin(job_thread_index);
         {
-            // Top edge - turn left
-            direction = 3;
-            dy = 0.0f;
-            dx = -0.005f;
-
-            plane.vertices[8 * 0 + 6 + 0] = 1;
-            plane.vertices[8 * 0 + 6 + 1] = 0;
-            plane.vertices[8 * 1 + 6 + 0] = 0;
-            plane.vertices[8 * 1 + 6 + 1] = 0;
-            plane.vertices[8 * 2 + 6 + 0] = 0;
-            plane.vertices[8 * 2 + 6 + 1] = 1;
-            plane.vertices[8 * 3 + 6 + 0] = 1;
-            plane.vertices[8 * 3 + 6 + 1] = 1;
+            PROFILE_ZONE("game_render");
+            game_code.render(&game_memory, &render_list, timestep.alpha());
         }
-        else if (cx <= -0.8f && direction == 3)
         {
-            // Left edge - turn down
-            direction = 0;
-            dx = 0.0f;
-            dy = -0.005f;
-
-            plane.vertices[8 * 0 + 6 + 0] = 0;
-            plane.vertices[8 * 0 + 6 + 1] = 0;
-            plane.vertices[8 * 1 + 6 + 0] = 0;
-            plane.vertices[8 * 1 + 6 + 1] = 1;
-            plane.vertices[8 * 2 + 6 + 0] = 1;
-            plane.vertices[8 * 2 + 6 + 1] = 1;
-            plane.vertices[8 * 3 + 6 + 0] = 1;
-            plane.vertices[8 * 3 + 6 + 1] = 0;
+            PROFILE_ZONE("sort draws");
+            render_queue.sort();
         }
-    };
-
-    while (!glfwWindowShouldClose(window))
-    {
-
-        auto dll_write_time = get_last_write_time("libgame.dylib");
-        if (dll_write_time > game_code.dll_last_write_time)
+        PROFILE_ZONE("submit draws");
         {
-            dlclose(game_code.game_code_handle);
-            load_game_code(&game_code);
+            GPU_ZONE(gpu_profiler, "clear");
+            glClearColor(render_list.clear_color[0], render_list.clear_color[1], render_list.clear_color[2], render_list.clear_color[3]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
         }
-        game_code.clear_color(&r, &g, &b, &a);
 
-        // Process input
-        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        for (uint32_t i = 0; i < GAME_SPRITE_COUNT; i++)
+            sprite_shaders[i]->set_mat4(view_projection_uniforms[i], &view_projection);
+        render_queue.execute([&](const GameDraw &draw, const SpriteInstance *sprites)
+                             { sprite_batch.draw(*sprite_shaders[draw.sprite], sprite_textures[draw.sprite], sprites, draw.sprite_count); });
         {
-            glfwSetWindowShouldClose(window, true);
+            GPU_ZONE(gpu_profiler, "draw sprites");
+            sprite_batch.flush();
+        }
+        frame_stream.end_frame();
+        gpu_profiler.end_frame();
+        gl_call_stats.end_frame();
+        gl_capture.end_frame();
+        render_seconds += now_seconds() - render_start; // not counting the wait for vsync in glfwSwapBuffers
+        frames++;
+        if (frames == frame_limit)
+        {
+            if (output_file)
+            {
+                int width = headless_context.width, height = headless_context.height;
+                window.framebuffer_size(&width, &height);
+                save_framebuffer_ppm(output_file, width, height); // before the swap, while the back buffer holds the frame
+            }
+            window.close();
         }
-
-        // Rendering
-        glClearColor(r, g, b, a);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-        flag.draw();
-        patrol_plane();
-        plane.draw();
 
         // Swap buffers and poll events
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (window.open())
+        {
+            PROFILE_ZONE("swap buffers");
+            window.swap_buffers();
+        }
     }
 
+    watcher.stop();
+    texture_loader.stop();
+    job_system.stop();
+    if (trace_file && profiler.write_chrome_trace(trace_file))
+        printf("Wrote %s\n", trace_file);
+    gl_capture.stop();
+    printf("Simulation: %llu ticks, %.3f ms per tick, %llu dropped; rendering: %llu frames, %.3f ms per frame\n",
+           (unsigned long long)timestep.ticks, timestep.ticks ? simulation_seconds * 1000 / timestep.ticks : 0.0,
+           (unsigned long long)timestep.dropped_ticks, (unsigned long long)frames, frames ? render_seconds * 1000 / frames : 0.0);
+    printf("GPU: %.3f ms per frame over %llu frames, %llu not ready in time\n",
+           gpu_profiler.frames_measured ? gpu_profiler.gpu_seconds * 1000 / gpu_profiler.frames_measured : 0.0,
+           (unsigned long long)gpu_profiler.frames_measured, (unsigned long long)gpu_profiler.frames_dropped);
+    printf("Render queue, last frame: %u draws, %u sprites, %u material changes\n",
+           render_queue.draws_recorded, render_queue.sprites_recorded, render_queue.material_changes);
+    gl_call_stats.print();
+    gl_capture.print();
+    std::cout << "GL state cache: " << gl_state.calls_issued << " calls issued, " << gl_state.calls_skipped << " skipped" << std::endl;
+    window.destroy();
+    headless_context.destroy();
     return 0;
 }
\ No newline at end of file
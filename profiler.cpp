@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Scoped CPU zones for finding where a frame goes:
+//
+//     PROFILE_ZONE("sort draws");
+//
+// records how long the rest of the enclosing block takes. Each thread writes
+// finished zones into its own ring, so recording takes no locks and costs a
+// clock read at each end; while the profiler is disabled it costs one relaxed
+// load. write_chrome_trace() saves the rings as Chrome trace event JSON, which
+// chrome://tracing and ui.perfetto.dev open.
+//
+// Names must outlive the profiler: string literals in the host, never in the
+// game library, which can be unloaded before the trace is written.
+struct Profiler
+{
+    static const uint32_t RING_SIZE = 1 << 16; // zones per thread; older ones are overwritten
+
+    struct Zone
+    {
+        const char *name;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+    };
+
+    // Allocated on a thread's first zone and kept until exit, after the thread is gone
+    struct Ring
+    {
+        Zone zones[RING_SIZE];
+        std::atomic<uint64_t> count{0}; // zones ever written
+        uint32_t thread_id;
+        char thread_name[32];
+    };
+
+    std::atomic<bool> enabled{false};
+    std::mutex rings_mutex;
+    std::vector<Ring *> rings;
+    static thread_local Ring *ring;
+    static thread_local const char *thread_name; // set_thread_name() before the first zone
+
+    static uint64_t now_ns()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void set_thread_name(const char *name)
+    {
+        thread_name = name;
+    }
+
+    void record(const char *name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        if (!ring)
+            ring = add_ring(thread_name ? thread_name : "thread");
+        record(ring, name, begin_ns, end_ns);
+    }
+
+    // Into a ring of one's own, for timelines that aren't the calling thread's
+    // (the GPU's). Only one thread may write to a ring.
+    void record(Ring *target, const char *name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        uint64_t index = target->count.load(std::memory_order_relaxed);
+        target->zones[index & (RING_SIZE - 1)] = {name, begin_ns, end_ns};
+        target->count.store(index + 1, std::memory_order_release);
+    }
+
+    Ring *add_ring(const char *name)
+    {
+        Ring *result = new Ring;
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        result->thread_id = (uint32_t)rings.size();
+        snprintf(result->thread_name, sizeof(result->thread_name), "%s", name);
+        rings.push_back(result);
+        return result;
+    }
+
+    // Writes the newest RING_SIZE zones of every thread. Zones still being
+    // recorded while this runs may come out torn; call it once the frame loop is done.
+    bool write_chrome_trace(const char *file)
+    {
+        FILE *out = fopen(file, "w");
+        if (!out)
+        {
+            printf("[%s:%d] Unable to write %s: %s\n", __FILE__, __LINE__, file, strerror(errno));
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        uint64_t origin_ns = UINT64_MAX;
+        for (Ring *r : rings)
+        {
+            uint64_t count = r->count.load(std::memory_order_acquire);
+            for (uint64_t i = count > RING_SIZE ? count - RING_SIZE : 0; i < count; i++)
+                origin_ns = std::min(origin_ns, r->zones[i & (RING_SIZE - 1)].begin_ns);
+        }
+
+        fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        const char *separator = "";
+        for (Ring *r : rings)
+        {
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    separator, r->thread_id, r->thread_name);
+            separator = ",\n";
+            uint64_t count = r->count.load(std::memory_order_acquire);
+            for (uint64_t i = count > RING_SIZE ? count - RING_SIZE : 0; i < count; i++)
+            {
+                const Zone &zone = r->zones[i & (RING_SIZE - 1)];
+                // Microseconds with nanosecond decimals, which the viewers accept
+                fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        separator, zone.name, r->thread_id, (zone.begin_ns - origin_ns) / 1000.0, (zone.end_ns - zone.begin_ns) / 1000.0);
+            }
+        }
+        fprintf(out, "\n]}\n");
+        bool ok = !ferror(out);
+        fclose(out);
+        return ok;
+    }
+};
+
+thread_local Profiler::Ring *Profiler::ring = nullptr;
+thread_local const char *Profiler::thread_name = nullptr;
+
+Profiler profiler;
+
+struct ProfileZone
+{
+    const char *name;
+    uint64_t begin_ns;
+
+    explicit ProfileZone(const char *name)
+        : name(name), begin_ns(profiler.enabled.load(std::memory_order_relaxed) ? Profiler::now_ns() : 0)
+    {
+    }
+
+    ~ProfileZone()
+    {
+        if (begin_ns)
+            profiler.record(name, begin_ns, Profiler::now_ns());
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
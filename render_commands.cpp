@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+// Owns the per-thread command buffers a GameRenderList records into and turns
+// them into one ordered stream for the GL thread. Knows nothing about GL:
+// execute() hands each draw to a callback, so recording can happen on any
+// thread and only the callback has to run on the context's.
+//
+// Every draw gets a 64-bit key, most significant bits first:
+//
+//   opaque:      layer:8 | 0 | shader:10 | texture:13 | depth:32
+//   translucent: layer:8 | 1 | depth:32 | shader:10 | texture:13
+//
+// so sorting the keys groups opaque draws by state, and orders translucent
+// ones by depth as blending requires, only grouping draws at equal depth.
+// Opaque draws keep ascending depth within a group too: there is no depth
+// buffer to resolve overlaps. Shader and texture are dense slots the host
+// assigns with set_material(), not GL names, so they fit the fields.
+struct RenderQueue
+{
+    static const uint32_t SHADER_BITS = 10;
+    static const uint32_t TEXTURE_BITS = 13;
+
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t buffer;
+        uint32_t draw;
+    };
+
+    std::vector<GameCommandBuffer> buffers;
+    std::vector<Entry> entries; // every draw of the frame, in key order after sort()
+    std::vector<Entry> scratch; // radix sort ping-pong
+    std::vector<uint32_t> materials; // per sprite kind: shader << TEXTURE_BITS | texture
+
+    unsigned int draws_recorded = 0;
+    unsigned int sprites_recorded = 0;
+    unsigned int material_changes = 0; // between consecutive draws after sorting, the first included
+
+    ~RenderQueue()
+    {
+        for (auto &buffer : buffers)
+        {
+            delete[] buffer.sprites;
+            delete[] buffer.draws;
+        }
+    }
+
+    // One buffer per thread that may record, i.e. per job_system worker
+    void init(unsigned int thread_count)
+    {
+        buffers.resize(std::max(1u, thread_count));
+        for (auto &buffer : buffers)
+        {
+            buffer.sprites = new SpriteInstance[GAME_MAX_SPRITES]; // only touched as far as it is used
+            buffer.draws = new GameDraw[GAME_MAX_DRAWS];
+        }
+    }
+
+    // Empties the buffers and points a render list at them
+    GameRenderList begin(uint32_t (*thread_index)())
+    {
+        for (auto &buffer : buffers)
+            buffer.sprite_count = buffer.draw_count = 0;
+        return {.buffers = buffers.data(), .buffer_count = (uint32_t)buffers.size(), .thread_index = thread_index};
+    }
+
+    // Sprite kinds needn't stop at GAME_SPRITE_COUNT; the bench has as many as it likes
+    void set_material(GameSprite sprite, uint32_t shader_slot, uint32_t texture_slot)
+    {
+        if (sprite >= materials.size())
+            materials.resize(sprite + 1);
+        uint32_t shader = std::min(shader_slot, (1u << SHADER_BITS) - 1);
+        uint32_t texture = std::min(texture_slot, (1u << TEXTURE_BITS) - 1);
+        materials[sprite] = shader << TEXTURE_BITS | texture;
+    }
+
+    uint64_t key(const GameDraw &draw) const
+    {
+        uint64_t key = (uint64_t)draw.layer << 56;
+        uint64_t material = draw.sprite < materials.size() ? materials[draw.sprite] : 0;
+        if (draw.translucent)
+            return key | 1ull << 55 | (uint64_t)draw.depth << (SHADER_BITS + TEXTURE_BITS) | material;
+        return key | material << 32 | draw.depth;
+    }
+
+    // Merges what every thread recorded and orders it by key. The sort is
+    // stable, so ties keep buffer order.
+    void sort()
+    {
+        entries.clear();
+        sprites_recorded = 0;
+        for (uint32_t b = 0; b < buffers.size(); b++)
+        {
+            const GameCommandBuffer &buffer = buffers[b];
+            for (uint32_t d = 0; d < buffer.draw_count; d++)
+                entries.push_back({key(buffer.draws[d]), b, d});
+            sprites_recorded += buffer.sprite_count;
+        }
+        draws_recorded = (unsigned int)entries.size();
+        radix_sort();
+
+        material_changes = 0;
+        uint32_t material = UINT32_MAX;
+        for (const Entry &entry : entries)
+        {
+            GameSprite sprite = buffers[entry.buffer].draws[entry.draw].sprite;
+            uint32_t next = sprite < materials.size() ? materials[sprite] : 0;
+            material_changes += next != material;
+            material = next;
+        }
+    }
+
+    // LSD radix sort on the key, a byte per pass. Passes where every key has
+    // the same byte are skipped, which is most of them: few layers, few
+    // materials and depths that only use the low bits.
+    void radix_sort()
+    {
+        const size_t count = entries.size();
+        if (count < 2)
+            return;
+        scratch.resize(count);
+
+        size_t histograms[8][256] = {};
+        for (const Entry &entry : entries)
+            for (int pass = 0; pass < 8; pass++)
+                histograms[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+
+        Entry *source = entries.data(), *destination = scratch.data();
+        for (int pass = 0; pass < 8; pass++)
+        {
+            size_t *histogram = histograms[pass];
+            const int shift = pass * 8;
+            if (histogram[(source[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            size_t offset = 0;
+            for (int digit = 0; digit < 256; digit++)
+            {
+                size_t digit_count = histogram[digit];
+                histogram[digit] = offset;
+                offset += digit_count;
+            }
+            for (size_t i = 0; i < count; i++)
+                destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+            std::swap(source, destination);
+        }
+        if (source != entries.data())
+            entries.swap(scratch);
+    }
+
+    // Calls submit(const GameDraw &, const SpriteInstance *sprites) for each draw in key order
+    template <typename Submit>
+    void execute(Submit &&submit) const
+    {
+        for (const Entry &entry : entries)
+        {
+            const GameCommandBuffer &buffer = buffers[entry.buffer];
+            const GameDraw &draw = buffer.draws[entry.draw];
+            submit(draw, buffer.sprites + draw.first_sprite);
+        }
+    }
+};
@@ -0,0 +1,674 @@
+#include <GL/glew.h>
+#ifndef __linux__
+#include <GLFW/glfw3.h> // only for the hidden window where there is no EGL
+#endif
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "profiler.cpp"
+#include "gpu_profiler.cpp"
+#include "file_data.cpp"
+#include "headless.cpp"
+#include "gl_capture_format.h"
+
+// Replays a frame capture written by main --capture, headless, and times it:
+//
+//   replay frames.glcap [--output last_frame.ppm] [--trace trace.json]
+//
+// Every recorded GL call is issued again in order, with the recorded
+// payloads, so a slow frame can be reproduced and bisected without the game,
+// its library or its assets. Reports CPU time per frame (issuing the calls,
+// including waits on fences where the capture waited) and GPU time per frame
+// from timestamp queries.
+
+// Captured object name -> the one this run created for it
+struct ReplayNames
+{
+    std::vector<GLuint> names;
+
+    void add(GLuint captured, GLuint replayed)
+    {
+        if (captured >= names.size())
+            names.resize(captured + 1, 0);
+        names[captured] = replayed;
+    }
+
+    // 0 for names the capture never saw created
+    GLuint operator[](GLuint captured) const
+    {
+        return captured < names.size() ? names[captured] : 0;
+    }
+};
+
+struct GLReplay
+{
+    const uint8_t *begin = nullptr;
+    const uint8_t *cursor = nullptr;
+    const uint8_t *end = nullptr;
+    bool failed = false;
+    bool frame_ended = false;
+    GLuint framebuffer = 0; // stands in for the default framebuffer and any the capture didn't create
+
+    std::vector<const uint8_t *> blob_data; // by id; points into the capture file
+    std::vector<uint64_t> blob_size;
+    ReplayNames buffers, vertex_arrays, textures, programs; // shaders share the programs' namespace
+    std::unordered_map<uint64_t, GLint> locations;         // captured program << 32 | captured location
+    std::unordered_map<uint64_t, GLsync> syncs;
+    std::vector<std::pair<GLenum, void *>> mappings;
+    std::vector<GLuint> scratch_names;
+
+    template <typename T>
+    T get()
+    {
+        T value = {};
+        if (end - cursor < (ptrdiff_t)sizeof(T))
+        {
+            failed = true;
+            cursor = end;
+            return value;
+        }
+        memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    const void *blob(uint32_t id)
+    {
+        if (id >= blob_data.size())
+        {
+            failed = id != 0;
+            return nullptr;
+        }
+        return blob_data[id];
+    }
+
+    // Reads the count and captured names of a glGen*/glDelete* call
+    const std::vector<GLuint> &get_names(GLsizei count)
+    {
+        scratch_names.resize(count > 0 ? count : 0);
+        for (GLuint &name : scratch_names)
+            name = get<GLuint>();
+        return scratch_names;
+    }
+
+    GLint location(GLuint program, GLint location) const
+    {
+        auto found = locations.find((uint64_t)program << 32 | (uint32_t)location);
+        return found != locations.end() ? found->second : -1;
+    }
+
+    // Issues the next record; returns false at the end of a frame or of the file
+    bool step()
+    {
+        if (cursor == end || failed)
+            return false;
+        GLCaptureOp op = get<GLCaptureOp>();
+        switch (op)
+        {
+        case GL_CAPTURE_BLOB:
+        {
+            uint32_t id = get<uint32_t>();
+            uint64_t size = get<uint64_t>();
+            if (failed || size > (uint64_t)(end - cursor) || id != blob_data.size())
+            {
+                failed = true;
+                return false;
+            }
+            blob_data.push_back(cursor);
+            blob_size.push_back(size);
+            cursor += size;
+            break;
+        }
+        case GL_CAPTURE_END_FRAME:
+            frame_ended = true;
+            return false;
+
+        case GL_CAPTURE_GEN_BUFFERS:
+        case GL_CAPTURE_GEN_VERTEX_ARRAYS:
+        case GL_CAPTURE_GEN_TEXTURES:
+        {
+            GLsizei count = get<GLsizei>();
+            const std::vector<GLuint> &captured = get_names(count);
+            std::vector<GLuint> created(captured.size());
+            ReplayNames &names = op == GL_CAPTURE_GEN_BUFFERS ? buffers : op == GL_CAPTURE_GEN_VERTEX_ARRAYS ? vertex_arrays : textures;
+            if (op == GL_CAPTURE_GEN_BUFFERS)
+                glGenBuffers((GLsizei)created.size(), created.data());
+            else if (op == GL_CAPTURE_GEN_VERTEX_ARRAYS)
+                glGenVertexArrays((GLsizei)created.size(), created.data());
+            else
+                glGenTextures((GLsizei)created.size(), created.data());
+            for (size_t i = 0; i < created.size(); i++)
+                names.add(captured[i], created[i]);
+            break;
+        }
+        case GL_CAPTURE_DELETE_BUFFERS:
+        case GL_CAPTURE_DELETE_VERTEX_ARRAYS:
+        case GL_CAPTURE_DELETE_TEXTURES:
+        {
+            GLsizei count = get<GLsizei>();
+            const std::vector<GLuint> &captured = get_names(count);
+            ReplayNames &names = op == GL_CAPTURE_DELETE_BUFFERS ? buffers : op == GL_CAPTURE_DELETE_VERTEX_ARRAYS ? vertex_arrays : textures;
+            std::vector<GLuint> deleted(captured.size());
+            for (size_t i = 0; i < captured.size(); i++)
+            {
+                deleted[i] = names[captured[i]];
+                names.add(captured[i], 0);
+            }
+            if (op == GL_CAPTURE_DELETE_BUFFERS)
+                glDeleteBuffers((GLsizei)deleted.size(), deleted.data());
+            else if (op == GL_CAPTURE_DELETE_VERTEX_ARRAYS)
+                glDeleteVertexArrays((GLsizei)deleted.size(), deleted.data());
+            else
+                glDeleteTextures((GLsizei)deleted.size(), deleted.data());
+            break;
+        }
+        case GL_CAPTURE_BIND_BUFFER:
+        {
+            GLenum target = get<GLenum>();
+            glBindBuffer(target, buffers[get<GLuint>()]);
+            break;
+        }
+        case GL_CAPTURE_BUFFER_DATA:
+        {
+            GLenum target = get<GLenum>();
+            int64_t size = get<int64_t>();
+            const void *data = blob(get<uint32_t>());
+            glBufferData(target, (GLsizeiptr)size, data, get<GLenum>());
+            break;
+        }
+        case GL_CAPTURE_BUFFER_SUB_DATA:
+        {
+            GLenum target = get<GLenum>();
+            int64_t offset = get<int64_t>();
+            int64_t size = get<int64_t>();
+            const void *data = blob(get<uint32_t>());
+            if (data)
+                glBufferSubData(target, (GLintptr)offset, (GLsizeiptr)size, data);
+            break;
+        }
+        case GL_CAPTURE_MAP_BUFFER_RANGE:
+        {
+            GLenum target = get<GLenum>();
+            int64_t offset = get<int64_t>();
+            int64_t length = get<int64_t>();
+            GLbitfield access = get<GLbitfield>();
+            void *pointer = glMapBufferRange(target, (GLintptr)offset, (GLsizeiptr)length, access);
+            if (pointer)
+                mappings.push_back({target, pointer});
+            break;
+        }
+        case GL_CAPTURE_UNMAP_BUFFER:
+        {
+            GLenum target = get<GLenum>();
+            uint32_t id = get<uint32_t>();
+            auto mapping = std::find_if(mappings.begin(), mappings.end(), [&](const auto &m) { return m.first == target; });
+            if (mapping == mappings.end())
+                break;
+            if (const void *data = blob(id))
+                memcpy(mapping->second, data, blob_size[id]);
+            mappings.erase(mapping);
+            glUnmapBuffer(target);
+            break;
+        }
+
+        case GL_CAPTURE_BIND_VERTEX_ARRAY:
+            glBindVertexArray(vertex_arrays[get<GLuint>()]);
+            break;
+        case GL_CAPTURE_VERTEX_ATTRIB_POINTER:
+        {
+            GLuint index = get<GLuint>();
+            GLint size = get<GLint>();
+            GLenum type = get<GLenum>();
+            GLboolean normalized = get<GLboolean>();
+            GLsizei stride = get<GLsizei>();
+            glVertexAttribPointer(index, size, type, normalized, stride, (const void *)(uintptr_t)get<uint64_t>());
+            break;
+        }
+        case GL_CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY:
+            glEnableVertexAttribArray(get<GLuint>());
+            break;
+        case GL_CAPTURE_VERTEX_ATTRIB_DIVISOR:
+        {
+            GLuint index = get<GLuint>();
+            glVertexAttribDivisor(index, get<GLuint>());
+            break;
+        }
+
+        case GL_CAPTURE_ACTIVE_TEXTURE:
+            glActiveTexture(get<GLenum>());
+            break;
+        case GL_CAPTURE_BIND_TEXTURE:
+        {
+            GLenum target = get<GLenum>();
+            glBindTexture(target, textures[get<GLuint>()]);
+            break;
+        }
+        case GL_CAPTURE_TEX_IMAGE_2D:
+        {
+            GLenum target = get<GLenum>();
+            GLint level = get<GLint>();
+            GLint internal_format = get<GLint>();
+            GLsizei width = get<GLsizei>();
+            GLsizei height = get<GLsizei>();
+            GLint border = get<GLint>();
+            GLenum format = get<GLenum>();
+            GLenum type = get<GLenum>();
+            const void *data = blob(get<uint32_t>());
+            uint64_t offset = get<uint64_t>(); // into the pixel unpack buffer
+            glTexImage2D(target, level, internal_format, width, height, border, format, type, data ? data : (const void *)(uintptr_t)offset);
+            break;
+        }
+        case GL_CAPTURE_COMPRESSED_TEX_IMAGE_2D:
+        {
+            GLenum target = get<GLenum>();
+            GLint level = get<GLint>();
+            GLenum format = get<GLenum>();
+            GLsizei width = get<GLsizei>();
+            GLsizei height = get<GLsizei>();
+            GLint border = get<GLint>();
+            GLsizei size = get<GLsizei>();
+            const void *data = blob(get<uint32_t>());
+            uint64_t offset = get<uint64_t>();
+            glCompressedTexImage2D(target, level, format, width, height, border, size, data ? data : (const void *)(uintptr_t)offset);
+            break;
+        }
+        case GL_CAPTURE_TEX_PARAMETERI:
+        {
+            GLenum target = get<GLenum>();
+            GLenum name = get<GLenum>();
+            glTexParameteri(target, name, get<GLint>());
+            break;
+        }
+        case GL_CAPTURE_GENERATE_MIPMAP:
+            glGenerateMipmap(get<GLenum>());
+            break;
+        case GL_CAPTURE_PIXEL_STOREI:
+        {
+            GLenum name = get<GLenum>();
+            glPixelStorei(name, get<GLint>());
+            break;
+        }
+
+        case GL_CAPTURE_CREATE_SHADER:
+        {
+            GLenum type = get<GLenum>();
+            programs.add(get<GLuint>(), glCreateShader(type));
+            break;
+        }
+        case GL_CAPTURE_SHADER_SOURCE:
+        {
+            GLuint shader = programs[get<GLuint>()];
+            GLsizei count = std::max(get<GLsizei>(), 0);
+            std::vector<const GLchar *> strings(count);
+            std::vector<GLint> lengths(count);
+            for (GLsizei i = 0; i < count; i++)
+            {
+                uint32_t id = get<uint32_t>();
+                strings[i] = (const GLchar *)blob(id);
+                lengths[i] = strings[i] ? (GLint)blob_size[id] : 0;
+            }
+            glShaderSource(shader, count, strings.data(), lengths.data());
+            break;
+        }
+        case GL_CAPTURE_COMPILE_SHADER:
+            glCompileShader(programs[get<GLuint>()]);
+            break;
+        case GL_CAPTURE_DELETE_SHADER:
+        case GL_CAPTURE_DELETE_PROGRAM:
+        {
+            GLuint captured = get<GLuint>();
+            if (op == GL_CAPTURE_DELETE_SHADER)
+                glDeleteShader(programs[captured]);
+            else
+                glDeleteProgram(programs[captured]);
+            programs.add(captured, 0);
+            break;
+        }
+        case GL_CAPTURE_CREATE_PROGRAM:
+            programs.add(get<GLuint>(), glCreateProgram());
+            break;
+        case GL_CAPTURE_ATTACH_SHADER:
+        {
+            GLuint program = programs[get<GLuint>()];
+            glAttachShader(program, programs[get<GLuint>()]);
+            break;
+        }
+        case GL_CAPTURE_PROGRAM_PARAMETERI:
+        {
+            GLuint program = programs[get<GLuint>()];
+            GLenum name = get<GLenum>();
+            glProgramParameteri(program, name, get<GLint>());
+            break;
+        }
+        case GL_CAPTURE_LINK_PROGRAM:
+            glLinkProgram(programs[get<GLuint>()]);
+            break;
+        case GL_CAPTURE_PROGRAM_BINARY:
+        {
+            GLuint program = programs[get<GLuint>()];
+            GLenum format = get<GLenum>();
+            const void *binary = blob(get<uint32_t>());
+            GLsizei length = get<GLsizei>();
+            glProgramBinary(program, format, binary, length);
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked)
+                printf("[%s:%d] This driver rejects a program binary from the capture; its draws will be missing\n", __FILE__, __LINE__);
+            break;
+        }
+        case GL_CAPTURE_USE_PROGRAM:
+            glUseProgram(programs[get<GLuint>()]);
+            break;
+        case GL_CAPTURE_GET_UNIFORM_LOCATION:
+        {
+            GLuint captured = get<GLuint>();
+            uint32_t id = get<uint32_t>();
+            GLint captured_location = get<GLint>();
+            const char *name = (const char *)blob(id);
+            if (name)
+            {
+                std::string terminated(name, blob_size[id]);
+                locations[(uint64_t)captured << 32 | (uint32_t)captured_location] = glGetUniformLocation(programs[captured], terminated.c_str());
+            }
+            break;
+        }
+        case GL_CAPTURE_PROGRAM_UNIFORM_1I:
+        {
+            GLuint captured = get<GLuint>();
+            GLint captured_location = get<GLint>();
+            glProgramUniform1i(programs[captured], location(captured, captured_location), get<GLint>());
+            break;
+        }
+        case GL_CAPTURE_PROGRAM_UNIFORM_1F:
+        {
+            GLuint captured = get<GLuint>();
+            GLint captured_location = get<GLint>();
+            glProgramUniform1f(programs[captured], location(captured, captured_location), get<GLfloat>());
+            break;
+        }
+        case GL_CAPTURE_PROGRAM_UNIFORM_FV:
+        case GL_CAPTURE_PROGRAM_UNIFORM_MATRIX_FV:
+        {
+            GLuint captured = get<GLuint>();
+            GLint captured_location = get<GLint>();
+            GLsizei count = std::max(get<GLsizei>(), 0);
+            GLboolean transpose = op == GL_CAPTURE_PROGRAM_UNIFORM_MATRIX_FV ? get<GLboolean>() : GL_FALSE;
+            uint8_t components = get<uint8_t>();
+            size_t floats = (size_t)count * components * (op == GL_CAPTURE_PROGRAM_UNIFORM_MATRIX_FV ? components : 1);
+            std::vector<GLfloat> values(floats);
+            for (GLfloat &value : values)
+                value = get<GLfloat>();
+            GLuint program = programs[captured];
+            GLint location = this->location(captured, captured_location);
+            if (op == GL_CAPTURE_PROGRAM_UNIFORM_MATRIX_FV)
+            {
+                if (components == 3)
+                    glProgramUniformMatrix3fv(program, location, count, transpose, values.data());
+                else if (components == 4)
+                    glProgramUniformMatrix4fv(program, location, count, transpose, values.data());
+            }
+            else if (components == 2)
+                glProgramUniform2fv(program, location, count, values.data());
+            else if (components == 3)
+                glProgramUniform3fv(program, location, count, values.data());
+            else if (components == 4)
+                glProgramUniform4fv(program, location, count, values.data());
+            break;
+        }
+
+        case GL_CAPTURE_BIND_FRAMEBUFFER:
+        {
+            GLenum target = get<GLenum>();
+            get<GLuint>(); // the capture never creates framebuffers; everything is drawn into ours
+            glBindFramebuffer(target, framebuffer);
+            break;
+        }
+        case GL_CAPTURE_VIEWPORT:
+        {
+            GLint x = get<GLint>(), y = get<GLint>();
+            GLsizei width = get<GLsizei>(), height = get<GLsizei>();
+            glViewport(x, y, width, height);
+            break;
+        }
+        case GL_CAPTURE_CLEAR_COLOR:
+        {
+            GLfloat red = get<GLfloat>(), green = get<GLfloat>(), blue = get<GLfloat>(), alpha = get<GLfloat>();
+            glClearColor(red, green, blue, alpha);
+            break;
+        }
+        case GL_CAPTURE_CLEAR:
+            glClear(get<GLbitfield>());
+            break;
+        case GL_CAPTURE_ENABLE:
+            glEnable(get<GLenum>());
+            break;
+        case GL_CAPTURE_DISABLE:
+            glDisable(get<GLenum>());
+            break;
+        case GL_CAPTURE_BLEND_FUNC:
+        {
+            GLenum source = get<GLenum>();
+            glBlendFunc(source, get<GLenum>());
+            break;
+        }
+        case GL_CAPTURE_DRAW_ELEMENTS_INSTANCED:
+        {
+            GLenum mode = get<GLenum>();
+            GLsizei count = get<GLsizei>();
+            GLenum type = get<GLenum>();
+            const void *indices = (const void *)(uintptr_t)get<uint64_t>();
+            glDrawElementsInstanced(mode, count, type, indices, get<GLsizei>());
+            break;
+        }
+        case GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX:
+        {
+            GLenum mode = get<GLenum>();
+            GLsizei count = get<GLsizei>();
+            GLenum type = get<GLenum>();
+            const void *indices = (const void *)(uintptr_t)get<uint64_t>();
+            glDrawElementsBaseVertex(mode, count, type, indices, get<GLint>());
+            break;
+        }
+
+        case GL_CAPTURE_FENCE_SYNC:
+        {
+            GLenum condition = get<GLenum>();
+            GLbitfield flags = get<GLbitfield>();
+            syncs[get<uint64_t>()] = glFenceSync(condition, flags);
+            break;
+        }
+        case GL_CAPTURE_CLIENT_WAIT_SYNC:
+        {
+            auto sync = syncs.find(get<uint64_t>());
+            GLbitfield flags = get<GLbitfield>();
+            GLuint64 timeout = get<GLuint64>();
+            if (sync != syncs.end())
+                glClientWaitSync(sync->second, flags, timeout);
+            break;
+        }
+        case GL_CAPTURE_DELETE_SYNC:
+        {
+            auto sync = syncs.find(get<uint64_t>());
+            if (sync != syncs.end())
+            {
+                glDeleteSync(sync->second);
+                syncs.erase(sync);
+            }
+            break;
+        }
+
+        default:
+            printf("[%s:%d] Unknown record %u at byte %td of the capture\n", __FILE__, __LINE__, op, cursor - 1 - begin);
+            failed = true;
+            return false;
+        }
+        return !failed;
+    }
+
+    // Issues records up to the end of the next frame. False when the capture ran
+    // out first: the calls after the last frame, or a broken file.
+    bool replay_frame()
+    {
+        frame_ended = false;
+        while (step())
+            ;
+        return frame_ended;
+    }
+};
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))];
+}
+
+int main(int argc, char **argv)
+{
+    const char *capture_file = nullptr;
+    const char *output_file = nullptr;
+    const char *trace_file = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--output") && i + 1 < argc)
+            output_file = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            trace_file = argv[++i];
+        else if (argv[i][0] != '-' && !capture_file)
+            capture_file = argv[i];
+        else
+            capture_file = nullptr, i = argc;
+    }
+    if (!capture_file)
+    {
+        fprintf(stderr, "usage: %s frames.glcap [--output last_frame.ppm] [--trace trace.json]\n", argv[0]);
+        return -1;
+    }
+    Profiler::set_thread_name("replay");
+    profiler.enabled = trace_file != nullptr;
+
+    FileData file;
+    if (!file.load(capture_file))
+        return -1;
+    GLCaptureHeader header;
+    if (file.size < sizeof(header) || (memcpy(&header, file.data, sizeof(header)), header.magic != GL_CAPTURE_MAGIC))
+    {
+        printf("[%s:%d] %s is not a frame capture\n", __FILE__, __LINE__, capture_file);
+        return -1;
+    }
+    if (header.version != GL_CAPTURE_VERSION)
+    {
+        printf("[%s:%d] %s is version %u, this replay reads version %u\n", __FILE__, __LINE__, capture_file, header.version, GL_CAPTURE_VERSION);
+        return -1;
+    }
+
+    HeadlessContext context;
+    context.width = (int)header.width;
+    context.height = (int)header.height;
+#ifdef __linux__
+    if (!context.init())
+    {
+        context.destroy();
+        return -1;
+    }
+#else
+    // No EGL: a hidden window's context, drawing into the same framebuffer headless uses
+    GLFWwindow *window = nullptr;
+    if (!glfwInit())
+    {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(context.width, context.height, "replay", NULL, NULL);
+    if (!window)
+    {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK || !context.create_framebuffer())
+    {
+        std::cerr << "Failed to initialize GLEW" << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return -1;
+    }
+#endif
+
+    GLReplay replay;
+    replay.begin = (const uint8_t *)file.data;
+    replay.cursor = replay.begin + sizeof(header);
+    replay.end = (const uint8_t *)file.data + file.size;
+    replay.framebuffer = context.FBO;
+    replay.blob_data.push_back(nullptr); // id 0: no data
+    replay.blob_size.push_back(0);
+
+    GpuProfiler gpu_profiler;
+    gpu_profiler.init();
+
+    // The first frame also creates and uploads everything, so it's reported on its own
+    std::vector<double> frame_ms;
+    double first_frame_ms = 0;
+    uint64_t frames = 0;
+    while (replay.cursor < replay.end && !replay.failed)
+    {
+        PROFILE_ZONE("replay frame");
+        uint64_t start_ns = Profiler::now_ns();
+        gpu_profiler.begin_frame();
+        int zone = gpu_profiler.begin("frame");
+        bool complete = replay.replay_frame();
+        gpu_profiler.end(zone);
+        gpu_profiler.end_frame();
+        if (!complete)
+            break; // shutdown calls after the last frame
+        double ms = (Profiler::now_ns() - start_ns) * 1e-6;
+        if (frames++ == 0)
+            first_frame_ms = ms;
+        else
+            frame_ms.push_back(ms);
+    }
+    glFinish();
+    if (replay.failed)
+        printf("[%s:%d] %s is truncated or corrupt; stopped after %llu frames\n", __FILE__, __LINE__, capture_file, (unsigned long long)frames);
+
+    if (output_file)
+        save_framebuffer_ppm(output_file, context.width, context.height);
+    if (trace_file && profiler.write_chrome_trace(trace_file))
+        printf("Wrote %s\n", trace_file);
+
+    std::vector<double> sorted = frame_ms;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double ms : frame_ms)
+        sum += ms;
+    size_t slowest = std::max_element(frame_ms.begin(), frame_ms.end()) - frame_ms.begin();
+    printf("Replayed %llu frames of %s (%ux%u), %zu payloads\n", (unsigned long long)frames, capture_file, header.width, header.height,
+           replay.blob_data.size() - 1);
+    printf("First frame, with loading: %.3f ms\n", first_frame_ms);
+    if (!frame_ms.empty())
+        printf("CPU: %.3f ms per frame, p50 %.3f, p90 %.3f, p99 %.3f, slowest %.3f ms in frame %zu\n", sum / frame_ms.size(),
+               percentile(sorted, 0.5), percentile(sorted, 0.9), percentile(sorted, 0.99), frame_ms[slowest], slowest + 1);
+    printf("GPU: %.3f ms per frame over %llu frames, %llu not ready in time\n",
+           gpu_profiler.frames_measured ? gpu_profiler.gpu_seconds * 1000 / gpu_profiler.frames_measured : 0.0,
+           (unsigned long long)gpu_profiler.frames_measured, (unsigned long long)gpu_profiler.frames_dropped);
+    context.destroy();
+#ifndef __linux__
+    glfwDestroyWindow(window);
+    glfwTerminate();
+#endif
+    return replay.failed ? -1 : 0;
+}
@@ -0,0 +1,22 @@
+#version 410 core
+
+// unit quad corner, (0,0) bottom left to (1,1) top right
+layout(location = 0) in vec2 aCorner;
+
+// per instance
+layout(location = 3) in vec4 iRect;     // x, y, w, h
+layout(location = 4) in vec4 iUV;       // uv origin, uv step across the width
+layout(location = 5) in vec2 iUVUp;     // uv step up the height
+layout(location = 6) in vec4 iColor;
+
+uniform mat4 view_projection = mat4(1.0);
+
+out vec3 vertex_color;
+out vec2 text_coord;
+
+void main()
+{
+    vertex_color = iColor.rgb;
+    text_coord = iUV.xy + aCorner.x * iUV.zw + aCorner.y * iUVUp;
+    gl_Position = view_projection * vec4(iRect.xy + aCorner * iRect.zw, 0.0, 1.0);
+}
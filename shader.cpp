@@ -2,35 +2,216 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include "vec_math.h"
 
 unsigned int create_shader(const char*vertex_file, const char*fragment_file);
+
+// Index into Shader::uniforms, resolved once by Shader::uniform(); an invalid handle is ignored by the setters
+struct UniformHandle
+{
+    int index = -1;
+};
+
 struct Shader
 {
     unsigned int ID;
+    std::string vertex_file;
+    std::string fragment_file;
+
+    struct Uniform
+    {
+        GLint location;
+        GLenum type;
+        GLint size; // array length
+        std::string name; // arrays without the trailing [0]
+    };
+    std::vector<Uniform> uniforms;
+    std::vector<int> uniform_table; // open addressing on the name hash, -1 = empty
     
     Shader(const char*vertex_file, const char*fragment_file)
+        : vertex_file(vertex_file), fragment_file(fragment_file)
     {
         ID = create_shader(vertex_file, fragment_file);
+        reflect_uniforms();
+    }
+
+    // Recompiles from the same files; keeps the current program if the new one doesn't link.
+    // Handles from uniform() must be resolved again afterwards.
+    bool reload()
+    {
+        unsigned int program = create_shader(vertex_file.c_str(), fragment_file.c_str());
+        GLint success = GL_FALSE;
+        if (program)
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            if (program)
+                gl_state.delete_program(program);
+            return false;
+        }
+        gl_state.delete_program(ID);
+        ID = program;
+        reflect_uniforms();
+        return true;
     }
     void use() const
     {
-        glUseProgram(ID);
+        gl_state.use_program(ID);
+    }
+
+    static uint32_t hash_name(std::string_view name)
+    {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (char c : name)
+            hash = (hash ^ (uint8_t)c) * 16777619u;
+        return hash;
+    }
+
+    // Build the name -> location table once after linking
+    void reflect_uniforms()
+    {
+        uniforms.clear();
+        GLint count = 0, max_length = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+        std::vector<char> name(max_length + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            Uniform uniform;
+            GLsizei length = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &uniform.size, &uniform.type, name.data());
+            uniform.location = glGetUniformLocation(ID, name.data());
+            if (uniform.location == -1)
+                continue; // uniform block member
+            uniform.name.assign(name.data(), length);
+            if (uniform.name.ends_with("[0]"))
+                uniform.name.resize(uniform.name.size() - 3);
+            uniforms.push_back(uniform);
+        }
+
+        size_t table_size = 16;
+        while (table_size < uniforms.size() * 2)
+            table_size *= 2;
+        uniform_table.assign(table_size, -1);
+        for (int i = 0; i < (int)uniforms.size(); i++)
+        {
+            size_t slot = hash_name(uniforms[i].name) & (table_size - 1);
+            while (uniform_table[slot] != -1)
+                slot = (slot + 1) & (table_size - 1);
+            uniform_table[slot] = i;
+        }
+    }
+
+    UniformHandle uniform(const std::string_view name) const
+    {
+        if (uniform_table.empty())
+            return {};
+        size_t mask = uniform_table.size() - 1;
+        for (size_t slot = hash_name(name) & mask; uniform_table[slot] != -1; slot = (slot + 1) & mask)
+        {
+            int index = uniform_table[slot];
+            if (uniforms[index].name == name)
+                return {index};
+        }
+        return {};
+    }
+
+    // Handle setters are an array index plus the GL call; glProgramUniform* doesn't need the program bound
+    void set_bool(UniformHandle handle, bool value) const
+    {
+        if (handle.index >= 0)
+            glProgramUniform1i(ID, uniforms[handle.index].location, (int)value);
+    }
+
+    void set_int(UniformHandle handle, int value) const
+    {
+        if (handle.index >= 0)
+            glProgramUniform1i(ID, uniforms[handle.index].location, value);
+    }
+
+    void set_float(UniformHandle handle, float value) const
+    {
+        if (handle.index >= 0)
+            glProgramUniform1f(ID, uniforms[handle.index].location, value);
+    }
+
+    void set_vec2(UniformHandle handle, vec2 value) const
+    {
+        if (handle.index >= 0)
+            glProgramUniform2fv(ID, uniforms[handle.index].location, 1, &value.x);
+    }
+
+    void set_vec3(UniformHandle handle, vec3 value) const
+    {
+        if (handle.index >= 0)
+            glProgramUniform3fv(ID, uniforms[handle.index].location, 1, &value.x);
     }
 
+    void set_vec4(UniformHandle handle, const vec4 &value) const
+    {
+        if (handle.index >= 0)
+            glProgramUniform4fv(ID, uniforms[handle.index].location, 1, &value.x);
+    }
+
+    // count > 1 fills a uniform array from consecutive matrices
+    void set_mat3(UniformHandle handle, const mat3 *value, int count = 1) const
+    {
+        if (handle.index >= 0)
+            glProgramUniformMatrix3fv(ID, uniforms[handle.index].location, count, GL_FALSE, &value->columns[0].x);
+    }
+
+    void set_mat4(UniformHandle handle, const mat4 *value, int count = 1) const
+    {
+        if (handle.index >= 0)
+            glProgramUniformMatrix4fv(ID, uniforms[handle.index].location, count, GL_FALSE, &value->columns[0].x);
+    }
+
+    // Name setters hash into the reflected table; resolve a handle instead on hot paths
     void set_bool(const std::string_view name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.data()), (int)value);
+        set_bool(uniform(name), value);
     }
 
     void set_int(const std::string_view name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.data()), value); 
+        set_int(uniform(name), value);
     }
 
     void set_float(const std::string_view name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.data()), value);
+        set_float(uniform(name), value);
+    }
+
+    void set_vec2(const std::string_view name, vec2 value) const
+    {
+        set_vec2(uniform(name), value);
+    }
+
+    void set_vec3(const std::string_view name, vec3 value) const
+    {
+        set_vec3(uniform(name), value);
+    }
+
+    void set_vec4(const std::string_view name, const vec4 &value) const
+    {
+        set_vec4(uniform(name), value);
+    }
+
+    void set_mat3(const std::string_view name, const mat3 &value) const
+    {
+        set_mat3(uniform(name), &value);
+    }
+
+    void set_mat4(const std::string_view name, const mat4 &value) const
+    {
+        set_mat4(uniform(name), &value);
     }
 };
 
@@ -58,42 +239,24 @@ void check_shader_errors(GLuint shader, const char *type)
 
 
 #include <sys/stat.h>
-#include <fcntl.h>
 #include <unistd.h>
-#include <cassert>
 
-std::string read_file(char const *fname)
+// Sources need not be NUL terminated
+unsigned int create_shader_from_source(std::string_view vertex_shader_source, std::string_view fragment_shader_source)
 {
-    static const auto BUFFER_SIZE = 16*1024;
-    int fd = open(fname, O_RDONLY);
-    if(fd == -1)
-        printf("[%s:%d] file open failed", __FILE__, __LINE__);
-
-#ifdef __linux__
-    /* Advise the kernel of our access pattern.  */
-    posix_fadvise(fd, 0, 0, 1);  // FDADVICE_SEQUENTIAL
-#endif
-
-    char buf[BUFFER_SIZE + 1];
-    uintmax_t lines = 0;
-    size_t bytes_read = read(fd, buf, BUFFER_SIZE);
-    buf[bytes_read] = 0;
-    assert(bytes_read<16*1024);
-
-    return (buf);
-}
+    PROFILE_ZONE("compile shader");
+    const GLchar *vertex_data = vertex_shader_source.data(), *fragment_data = fragment_shader_source.data();
+    GLint vertex_length = (GLint)vertex_shader_source.size(), fragment_length = (GLint)fragment_shader_source.size();
 
-unsigned int create_shader_from_source(const char*vertex_shader_source, const char*fragment_shader_source)
-{
     // Compile vertex shader
     GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_source, NULL);
+    glShaderSource(vertex_shader, 1, &vertex_data, &vertex_length);
     glCompileShader(vertex_shader);
     check_shader_errors(vertex_shader, "VERTEX");
 
     // Compile fragment shader
     GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_source, NULL);
+    glShaderSource(fragment_shader, 1, &fragment_data, &fragment_length);
     glCompileShader(fragment_shader);
     check_shader_errors(fragment_shader, "FRAGMENT");
 
@@ -101,6 +264,7 @@ unsigned int create_shader_from_source(const char*vertex_shader_source, const ch
     GLuint shader_program = glCreateProgram();
     glAttachShader(shader_program, vertex_shader);
     glAttachShader(shader_program, fragment_shader);
+    glProgramParameteri(shader_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(shader_program);
     check_shader_errors(shader_program, "PROGRAM");
     
@@ -111,9 +275,139 @@ unsigned int create_shader_from_source(const char*vertex_shader_source, const ch
 }
 
 
+//--------[ Program binary cache ]--------------------------------
+// Linked programs are stored in SHADER_CACHE_DIR as <key>.bin where the key
+// hashes both sources and the driver's vendor/renderer/version strings, so a
+// source edit or driver update simply misses the cache. A binary the driver
+// refuses is recompiled from source and overwritten.
+
+#include <cstdio>
+
+static const char *SHADER_CACHE_DIR = "shader_cache";
+static const uint32_t PROGRAM_BINARY_MAGIC = 0x42505347; // "GSPB"
+
+struct ProgramBinaryHeader
+{
+    uint32_t magic;
+    uint32_t binary_format;
+    uint64_t key;
+    uint64_t length;
+};
+
+uint64_t hash64(const void *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull; // FNV-1a
+    return hash;
+}
+
+uint64_t program_cache_key(std::string_view vertex_source, std::string_view fragment_source)
+{
+    uint64_t key = hash64(vertex_source.data(), vertex_source.size());
+    key = hash64("\0", 1, key);
+    key = hash64(fragment_source.data(), fragment_source.size(), key);
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+        const char *value = (const char *)glGetString(name);
+        if (value)
+            key = hash64(value, strlen(value), key);
+    }
+    return key;
+}
+
+std::string program_cache_path(uint64_t key)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%016llx.bin", SHADER_CACHE_DIR, (unsigned long long)key);
+    return path;
+}
+
+// Returns 0 on a miss or when the driver rejects the stored binary
+unsigned int load_program_binary(uint64_t key)
+{
+    std::string path = program_cache_path(key);
+    if (access(path.c_str(), R_OK) != 0)
+        return 0;
+    FileData file;
+    if (!file.load(path.c_str()) || file.size < sizeof(ProgramBinaryHeader))
+        return 0;
+
+    ProgramBinaryHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    if (header.magic != PROGRAM_BINARY_MAGIC || header.key != key || header.length != file.size - sizeof(header))
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binary_format, file.data + sizeof(header), (GLsizei)header.length);
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void save_program_binary(unsigned int program, uint64_t key)
+{
+    GLint success = GL_FALSE, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0)
+        return;
+
+    ProgramBinaryHeader header = {.magic = PROGRAM_BINARY_MAGIC, .key = key};
+    std::vector<uint8_t> binary(length);
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &header.binary_format, binary.data());
+    header.length = (uint64_t)written;
+
+    mkdir(SHADER_CACHE_DIR, 0755);
+    // Write to a temporary name and rename so a crash never leaves a torn cache file
+    std::string path = program_cache_path(key);
+    std::string temp_path = path + ".tmp";
+    FILE *file = fopen(temp_path.c_str(), "wb");
+    if (!file)
+    {
+        printf("[%s:%d] Unable to write program cache: %s\n", __FILE__, __LINE__, temp_path.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(binary.data(), 1, written, file) == (size_t)written;
+    ok = fclose(file) == 0 && ok;
+    if (ok)
+        rename(temp_path.c_str(), path.c_str());
+    else
+        unlink(temp_path.c_str());
+}
+
+bool program_binaries_supported()
+{
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
 unsigned int create_shader(const char*vertex_file, const char*fragment_file)
 {
-    auto vertex_source = read_file(vertex_file);
-    auto fragment_source = read_file(fragment_file);
-    return create_shader_from_source(vertex_source.c_str(), fragment_source.c_str());
-}
\ No newline at end of file
+    PROFILE_ZONE("create shader"); // compile and link, or load the cached binary
+    FileData vertex_file_data, fragment_file_data;
+    if (!vertex_file_data.load(vertex_file) || !fragment_file_data.load(fragment_file))
+        return 0;
+    std::string_view vertex_source = vertex_file_data.view();
+    std::string_view fragment_source = fragment_file_data.view();
+
+    static const bool use_cache = program_binaries_supported();
+    if (!use_cache)
+        return create_shader_from_source(vertex_source, fragment_source);
+
+    uint64_t key = program_cache_key(vertex_source, fragment_source);
+    if (unsigned int program = load_program_binary(key))
+        return program;
+
+    unsigned int program = create_shader_from_source(vertex_source, fragment_source);
+    save_program_binary(program, key);
+    return program;
+}
@@ -0,0 +1,258 @@
+#include <GL/glew.h>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "game.h" // SpriteInstance
+
+// Collects textured quads for a frame and draws them with one upload per
+// MAX_SPRITES and one draw call per shader/texture run. Sorted sprites are
+// written straight into a StreamBuffer shared with the rest of the frame.
+//
+// Vertex mode expands every sprite into 4 vertices of 8 floats
+// (pos, color, uv) so the existing shaders work unchanged. Instanced mode
+// draws a shared unit quad with glDrawElementsInstanced and reads one
+// SpriteInstance per sprite; it needs res/shaders/sprite_instanced.vert.
+struct SpriteBatch
+{
+    static constexpr int FLOATS_PER_VERTEX = 8;
+    static constexpr int FLOATS_PER_SPRITE = 4 * FLOATS_PER_VERTEX;
+    static constexpr int MAX_SPRITES = 16384; // 4 * MAX_SPRITES must fit in GLushort indices
+
+    struct Entry
+    {
+        uint64_t key; // program << 32 | texture
+        uint32_t index;
+    };
+
+    bool instanced = false;        // pick before init()
+    bool presorted = false;        // draws already arrive in the order to submit them, e.g. from RenderQueue
+    StreamBuffer *stream = nullptr; // set before init()
+
+    std::vector<float> vertices;             // vertex mode, in submission order
+    std::vector<SpriteInstance> instances;   // instanced mode, in submission order
+    std::vector<Entry> entries;
+
+    GLuint VAO;
+    GLuint EBO;
+    GLuint quad_VBO; // unit quad, instanced mode only
+
+    unsigned int draw_calls = 0;
+    unsigned int sprites_drawn = 0;
+
+    size_t sprite_size() const
+    {
+        return instanced ? sizeof(SpriteInstance) : FLOATS_PER_SPRITE * sizeof(float);
+    }
+
+    void init()
+    {
+        glGenVertexArrays(1, &VAO);
+        gl_state.bind_vertex_array(VAO);
+
+        // Every sprite has the same topology, so the index buffer is built once
+        int index_sprites = instanced ? 1 : MAX_SPRITES;
+        std::vector<GLushort> indices(index_sprites * 6);
+        for (int i = 0; i < index_sprites; i++)
+        {
+            GLushort v = (GLushort)(i * 4);
+            GLushort *idx = &indices[i * 6];
+            idx[0] = v + 0; idx[1] = v + 1; idx[2] = v + 3; // first triangle
+            idx[3] = v + 1; idx[4] = v + 2; idx[5] = v + 3; // second triangle
+        }
+        glGenBuffers(1, &EBO);
+        gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indices.size() * sizeof(indices.front()), indices.data(), GL_STATIC_DRAW);
+
+        if (instanced)
+        {
+            const float corners[] = {
+                1, 1, // top right
+                1, 0, // bottom right
+                0, 0, // bottom left
+                0, 1, // top left
+            };
+            glGenBuffers(1, &quad_VBO);
+            gl_state.bind_buffer(GL_ARRAY_BUFFER, quad_VBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
+            glEnableVertexAttribArray(0);
+        }
+
+        gl_state.bind_buffer(GL_ARRAY_BUFFER, stream->buffer);
+
+        if (instanced)
+        {
+            for (GLuint attribute = 3; attribute <= 6; attribute++)
+            {
+                glEnableVertexAttribArray(attribute);
+                glVertexAttribDivisor(attribute, 1);
+            }
+            set_instance_offset(0);
+        }
+        else
+        {
+            // Position attribute
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void *)0);
+            glEnableVertexAttribArray(0);
+            // Color attribute
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void *)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            // UV attribute
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void *)(6 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+        }
+
+        gl_state.bind_vertex_array(0);
+    }
+
+    // GL 4.1 has no base instance, so each run re-points the instance attributes at its first sprite
+    void set_instance_offset(size_t base)
+    {
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, x)));
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, uv)));
+        glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, uv) + 4 * sizeof(float)));
+        glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), (void *)(base + offsetof(SpriteInstance, color)));
+    }
+
+    void draw(const Shader &shader, GLuint texture, const SpriteInstance &sprite)
+    {
+        entries.push_back({(uint64_t)shader.ID << 32 | texture, (uint32_t)entries.size()});
+        if (instanced)
+        {
+            instances.push_back(sprite);
+            return;
+        }
+
+        float r = sprite.color[0] / 255.0f, g = sprite.color[1] / 255.0f, b = sprite.color[2] / 255.0f;
+        const float *uv = sprite.uv;
+        const float corners[4][2] = {{1, 1}, {1, 0}, {0, 0}, {0, 1}}; // top right, bottom right, bottom left, top left
+        for (auto &c : corners)
+        {
+            const float vertex[FLOATS_PER_VERTEX] = {
+                /* pos */ sprite.x + c[0] * sprite.w, sprite.y + c[1] * sprite.h, 0.0f,
+                /* color */ r, g, b,
+                /* uv */ uv[0] + c[0] * uv[2] + c[1] * uv[4], uv[1] + c[0] * uv[3] + c[1] * uv[5],
+            };
+            vertices.insert(vertices.end(), vertex, vertex + FLOATS_PER_VERTEX);
+        }
+    }
+
+    // count sprites sharing a shader and texture
+    void draw(const Shader &shader, GLuint texture, const SpriteInstance *sprites, size_t count)
+    {
+        if (!instanced)
+        {
+            for (size_t i = 0; i < count; i++)
+                draw(shader, texture, sprites[i]);
+            return;
+        }
+
+        uint64_t key = (uint64_t)shader.ID << 32 | texture;
+        size_t first = entries.size();
+        entries.resize(first + count);
+        for (size_t i = 0; i < count; i++)
+            entries[first + i] = {key, (uint32_t)(first + i)};
+        instances.insert(instances.end(), sprites, sprites + count);
+    }
+
+    // quad_vertices: 4 vertices of pos, color, uv, ordered top right, bottom right, bottom left, top left.
+    // Instanced mode keeps only the axis-aligned rect, the uv mapping and the bottom left color.
+    void draw(const Shader &shader, GLuint texture, const float *quad_vertices)
+    {
+        if (!instanced)
+        {
+            entries.push_back({(uint64_t)shader.ID << 32 | texture, (uint32_t)entries.size()});
+            vertices.insert(vertices.end(), quad_vertices, quad_vertices + FLOATS_PER_SPRITE);
+            return;
+        }
+
+        const float *br = quad_vertices + 1 * FLOATS_PER_VERTEX;
+        const float *bl = quad_vertices + 2 * FLOATS_PER_VERTEX;
+        const float *tl = quad_vertices + 3 * FLOATS_PER_VERTEX;
+        SpriteInstance sprite = {
+            .x = bl[0], .y = bl[1], .w = br[0] - bl[0], .h = tl[1] - bl[1],
+            .uv = {bl[6], bl[7], br[6] - bl[6], br[7] - bl[7], tl[6] - bl[6], tl[7] - bl[7]},
+            .color = {(uint8_t)(bl[3] * 255), (uint8_t)(bl[4] * 255), (uint8_t)(bl[5] * 255), 255},
+        };
+        draw(shader, texture, sprite);
+    }
+
+    void flush()
+    {
+        draw_calls = 0;
+        sprites_drawn = (unsigned int)entries.size();
+        if (entries.empty())
+            return;
+
+        // Sort by shader, then texture; ties keep submission order
+        if (!presorted)
+            std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+                      { return a.key != b.key ? a.key < b.key : a.index < b.index; });
+
+        const size_t size = sprite_size();
+        const size_t vertex_size = FLOATS_PER_VERTEX * sizeof(float);
+        const uint8_t *source = instanced ? (const uint8_t *)instances.data() : (const uint8_t *)vertices.data();
+
+        gl_state.bind_vertex_array(VAO);
+        gl_state.active_texture(GL_TEXTURE0);
+
+        for (size_t chunk = 0; chunk < entries.size(); chunk += MAX_SPRITES)
+        {
+            size_t chunk_end = std::min(entries.size(), chunk + MAX_SPRITES);
+
+            // Gather in sorted order straight into the mapped ring; vertex mode needs
+            // whole-vertex alignment for the base vertex
+            size_t offset;
+            size_t alignment = instanced ? 4 : vertex_size;
+            uint8_t *dst = (uint8_t *)stream->map((chunk_end - chunk) * size, alignment, &offset);
+            if (!dst)
+            {
+                // Once more after pushing out queued work; past that only this chunk is lost
+                glFlush();
+                dst = (uint8_t *)stream->map((chunk_end - chunk) * size, alignment, &offset);
+            }
+            if (!dst)
+            {
+                printf("[%s:%d] Unable to map the stream buffer, dropping %zu sprites\n", __FILE__, __LINE__, chunk_end - chunk);
+                sprites_drawn -= (unsigned int)(chunk_end - chunk);
+                continue;
+            }
+            for (size_t i = chunk; i < chunk_end; i++)
+                memcpy(dst + (i - chunk) * size, source + entries[i].index * size, size);
+            stream->unmap();
+            // the map left the ring bound; instance attribute pointers below read from it
+
+            for (size_t run = chunk; run < chunk_end;)
+            {
+                uint64_t key = entries[run].key;
+                size_t run_end = run + 1;
+                while (run_end < chunk_end && entries[run_end].key == key)
+                    run_end++;
+
+                gl_state.use_program((GLuint)(key >> 32));
+                gl_state.bind_texture((GLuint)key);
+
+                if (instanced)
+                {
+                    set_instance_offset(offset + (run - chunk) * size);
+                    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0, (GLsizei)(run_end - run));
+                }
+                else
+                {
+                    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)((run_end - run) * 6), GL_UNSIGNED_SHORT,
+                                             (void *)((run - chunk) * 6 * sizeof(GLushort)), (GLint)(offset / vertex_size));
+                }
+                draw_calls++;
+                run = run_end;
+            }
+        }
+
+        entries.clear();
+        vertices.clear();
+        instances.clear();
+    }
+};
@@ -0,0 +1,103 @@
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstdio>
+
+// Triple-buffered ring for geometry that is rewritten every frame.
+// The buffer is split into FRAMES segments; a frame only writes into its own
+// segment with unsynchronized maps, and a fence keeps the segment from being
+// reused until the GPU has finished reading it. When a frame outgrows its
+// segment the whole buffer is orphaned (and grown if needed) instead.
+struct StreamBuffer
+{
+    static constexpr int FRAMES = 3;
+
+    GLenum target = GL_ARRAY_BUFFER;
+    GLuint buffer = 0;
+    size_t segment_size = 0;
+    int frame = 0;   // segment written this frame
+    size_t head = 0; // next free byte inside the segment
+    GLsync fences[FRAMES] = {};
+
+    // stats, reset by the caller
+    unsigned int stalls = 0;  // end_frame() had to wait for the GPU
+    unsigned int orphans = 0; // a frame overflowed its segment
+    size_t bytes_written = 0;
+
+    void init(GLenum buffer_target, size_t bytes_per_frame)
+    {
+        target = buffer_target;
+        segment_size = (bytes_per_frame + 255) & ~(size_t)255;
+        glGenBuffers(1, &buffer);
+        gl_state.bind_buffer(target, buffer);
+        glBufferData(target, (GLsizeiptr)(segment_size * FRAMES), NULL, GL_STREAM_DRAW);
+    }
+
+    // Returns a write pointer for `size` bytes. *offset receives the byte offset
+    // inside the buffer, which is a multiple of `alignment` (need not be a power of two).
+    // Leaves the buffer bound to its target; call unmap() before drawing.
+    void *map(size_t size, size_t alignment, size_t *offset)
+    {
+        gl_state.bind_buffer(target, buffer);
+
+        size_t start = frame * segment_size;
+        size_t aligned = (start + head + alignment - 1) / alignment * alignment;
+        if (aligned + size > start + segment_size)
+        {
+            if (size + alignment > segment_size)
+            {
+                while (size + alignment > segment_size)
+                    segment_size *= 2;
+                printf("[%s:%d] stream buffer grown to %zu bytes per frame\n", __FILE__, __LINE__, segment_size);
+            }
+            // Orphan: the driver hands us fresh storage and keeps the old one alive for in-flight draws
+            glBufferData(target, (GLsizeiptr)(segment_size * FRAMES), NULL, GL_STREAM_DRAW);
+            for (auto &fence : fences)
+            {
+                if (fence)
+                    glDeleteSync(fence);
+                fence = 0;
+            }
+            orphans++;
+            head = 0;
+            start = frame * segment_size;
+            aligned = (start + alignment - 1) / alignment * alignment;
+        }
+
+        void *ptr = glMapBufferRange(target, (GLintptr)aligned, (GLsizeiptr)size,
+                                     GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (!ptr)
+        {
+            printf("[%s:%d] glMapBufferRange failed: 0x%x\n", __FILE__, __LINE__, glGetError());
+            return NULL;
+        }
+        head = aligned + size - start;
+        bytes_written += size;
+        *offset = aligned;
+        return ptr;
+    }
+
+    void unmap()
+    {
+        glUnmapBuffer(target);
+    }
+
+    // Call once per frame after the last draw that reads this frame's data
+    void end_frame()
+    {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame = (frame + 1) % FRAMES;
+        head = 0;
+
+        GLsync fence = fences[frame];
+        if (!fence)
+            return;
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            stalls++;
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                ;
+        }
+        glDeleteSync(fence);
+        fences[frame] = 0;
+    }
+};
@@ -0,0 +1,108 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "atlas_format.h"
+
+// Where a named image lives: a texture and the uv rect it covers
+struct AtlasRegion
+{
+    GLuint texture;
+    UVRect uv;
+};
+
+// Runtime side of atlas_packer. Pages are uploaded straight from the mapped
+// .atlas file; region() looks images up by file name and falls back to
+// loading the file on its own when it isn't packed, so the game runs with or
+// without a baked atlas.
+struct TextureAtlas
+{
+    std::vector<GLuint> pages;
+    std::vector<AtlasEntry> entries; // sorted by name
+
+    bool load(const char *atlas_file)
+    {
+        if (access(atlas_file, R_OK) != 0)
+            return false;
+        FileData file;
+        if (!file.load(atlas_file))
+            return false;
+
+        AtlasHeader header;
+        if (file.size < sizeof(header))
+            return false;
+        memcpy(&header, file.data, sizeof(header));
+        size_t tables_size = sizeof(header) + header.page_count * sizeof(AtlasPage) + header.entry_count * sizeof(AtlasEntry);
+        if (header.magic != ATLAS_MAGIC || header.version != ATLAS_VERSION || file.size < tables_size)
+        {
+            printf("[%s:%d] Not a valid atlas: %s\n", __FILE__, __LINE__, atlas_file);
+            return false;
+        }
+
+        std::vector<AtlasPage> page_headers(header.page_count);
+        memcpy(page_headers.data(), file.data + sizeof(header), header.page_count * sizeof(AtlasPage));
+        entries.resize(header.entry_count);
+        memcpy(entries.data(), file.data + sizeof(header) + header.page_count * sizeof(AtlasPage), header.entry_count * sizeof(AtlasEntry));
+        for (auto &entry : entries)
+        {
+            // region() indexes pages with it and find() strcmps the name
+            if (entry.page >= header.page_count || !memchr(entry.name, 0, sizeof(entry.name)))
+            {
+                printf("[%s:%d] Not a valid atlas: %s\n", __FILE__, __LINE__, atlas_file);
+                unload();
+                return false;
+            }
+        }
+
+        gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (auto &page : page_headers)
+        {
+            // Compared without sums that could wrap on a corrupt header
+            uint64_t pixels = (uint64_t)page.width * page.height;
+            if (pixels > file.size / 4 || page.offset > file.size || pixels * 4 > file.size - page.offset)
+            {
+                printf("[%s:%d] Truncated atlas: %s\n", __FILE__, __LINE__, atlas_file);
+                unload();
+                return false;
+            }
+
+            GLuint texture_id;
+            glGenTextures(1, &texture_id);
+            gl_state.bind_texture(texture_id);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page.width, page.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, file.data + page.offset);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            pages.push_back(texture_id);
+        }
+        return true;
+    }
+
+    // Deletes the page textures created so far and forgets every entry
+    void unload()
+    {
+        for (GLuint texture : pages)
+            gl_state.delete_texture(texture);
+        pages.clear();
+        entries.clear();
+    }
+
+    const AtlasEntry *find(const char *name) const
+    {
+        auto it = std::lower_bound(entries.begin(), entries.end(), name, [](const AtlasEntry &entry, const char *key)
+                                   { return strcmp(entry.name, key) < 0; });
+        return it != entries.end() && !strcmp(it->name, name) ? &*it : nullptr;
+    }
+
+    // texture_file is the path texture_loader.load() would take; the atlas is searched by its file name
+    AtlasRegion region(const char *texture_file) const
+    {
+        const char *slash = strrchr(texture_file, '/');
+        if (const AtlasEntry *entry = find(slash ? slash + 1 : texture_file))
+            return {pages[entry->page], {entry->u0, entry->v0, entry->u1, entry->v1}};
+        return {texture_loader.load(texture_file), {0, 0, 1, 1}};
+    }
+};
@@ -0,0 +1,284 @@
+// Offline tool: converts images into GPU-compressed textures with a full mip
+// chain so the game can upload them without decoding or glGenerateMipmap.
+//
+//   texture_cooker <image or directory>...
+//
+// Writes <image>.ctex next to every input (see cooked_texture_format.h).
+// Opaque images become BC1 (8x smaller than RGBA8), images with any
+// transparency BC3 (4x). Blocks are encoded with a bounding-box range fit.
+
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "cooked_texture_format.h"
+
+struct Image
+{
+    int width, height;
+    std::vector<uint8_t> pixels; // RGBA8
+
+    const uint8_t *at(int x, int y) const
+    {
+        x = std::min(x, width - 1);
+        y = std::min(y, height - 1);
+        return &pixels[((size_t)y * width + x) * 4];
+    }
+};
+
+static Image downsample(const Image &source)
+{
+    Image result;
+    result.width = std::max(1, source.width / 2);
+    result.height = std::max(1, source.height / 2);
+    result.pixels.resize((size_t)result.width * result.height * 4);
+    for (int y = 0; y < result.height; y++)
+        for (int x = 0; x < result.width; x++)
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = source.at(2 * x, 2 * y)[c] + source.at(2 * x + 1, 2 * y)[c] +
+                          source.at(2 * x, 2 * y + 1)[c] + source.at(2 * x + 1, 2 * y + 1)[c];
+                result.pixels[((size_t)y * result.width + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+            }
+    return result;
+}
+
+static uint16_t pack565(const int color[3])
+{
+    int r = (color[0] * 31 + 127) / 255;
+    int g = (color[1] * 63 + 127) / 255;
+    int b = (color[2] * 31 + 127) / 255;
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static void unpack565(uint16_t packed, int color[3])
+{
+    int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+}
+
+// 8 bytes: two 565 endpoints and 2-bit indices, always in 4-color mode
+static void encode_bc1_block(const uint8_t block[16][4], uint8_t *out)
+{
+    int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+        {
+            lo[c] = std::min(lo[c], (int)block[i][c]);
+            hi[c] = std::max(hi[c], (int)block[i][c]);
+        }
+    // Inset the box a little; the extremes are usually outliers of the interpolated palette
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (hi[c] - lo[c]) / 16;
+        lo[c] += inset;
+        hi[c] -= inset;
+    }
+
+    uint16_t c0 = pack565(hi), c1 = pack565(lo);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int palette[4][3];
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, best_error = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = block[i][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    out[0] = (uint8_t)c0;
+    out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)c1;
+    out[3] = (uint8_t)(c1 >> 8);
+    memcpy(out + 4, &indices, 4);
+}
+
+// 8 bytes: two alpha endpoints (a0 > a1, 8-entry palette) and 3-bit indices
+static void encode_bc3_alpha_block(const uint8_t block[16][4], uint8_t *out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int)block[i][3]);
+        a1 = std::min(a1, (int)block[i][3]);
+    }
+
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        int palette[8] = {a0, a1};
+        for (int p = 1; p <= 6; p++)
+            palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, best_error = 1 << 30;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs(block[i][3] - palette[p]);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (uint8_t)(indices >> (8 * i));
+}
+
+static std::vector<uint8_t> encode(const Image &image, bool alpha)
+{
+    int blocks_x = (image.width + 3) / 4, blocks_y = (image.height + 3) / 4;
+    size_t block_size = alpha ? 16 : 8;
+    std::vector<uint8_t> out((size_t)blocks_x * blocks_y * block_size);
+    uint8_t *dst = out.data();
+    for (int by = 0; by < blocks_y; by++)
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            // Edge blocks repeat the last row/column
+            uint8_t block[16][4];
+            for (int y = 0; y < 4; y++)
+                for (int x = 0; x < 4; x++)
+                    memcpy(block[y * 4 + x], image.at(bx * 4 + x, by * 4 + y), 4);
+            if (alpha)
+            {
+                encode_bc3_alpha_block(block, dst);
+                dst += 8;
+            }
+            encode_bc1_block(block, dst);
+            dst += 8;
+        }
+    return out;
+}
+
+static bool cook(const std::string &path)
+{
+    stbi_set_flip_vertically_on_load(true);
+    Image image;
+    int channels;
+    uint8_t *pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+    if (!pixels)
+    {
+        fprintf(stderr, "[%s:%d] Unable to load %s: %s\n", __FILE__, __LINE__, path.c_str(), stbi_failure_reason());
+        return false;
+    }
+    image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+    stbi_image_free(pixels);
+
+    bool alpha = false;
+    for (size_t i = 3; i < image.pixels.size() && !alpha; i += 4)
+        alpha = image.pixels[i] != 255;
+
+    std::vector<std::vector<uint8_t>> levels;
+    std::vector<CookedTextureLevel> level_headers;
+    for (Image level = image;; level = downsample(level))
+    {
+        levels.push_back(encode(level, alpha));
+        level_headers.push_back({(uint32_t)level.width, (uint32_t)level.height, 0, levels.back().size()});
+        if (level.width == 1 && level.height == 1)
+            break;
+    }
+
+    CookedTextureHeader header = {.magic = COOKED_TEXTURE_MAGIC, .version = COOKED_TEXTURE_VERSION,
+                                  .gl_format = alpha ? COOKED_FORMAT_BC3 : COOKED_FORMAT_BC1,
+                                  .width = (uint32_t)image.width, .height = (uint32_t)image.height,
+                                  .level_count = (uint32_t)levels.size()};
+    uint64_t offset = sizeof(header) + level_headers.size() * sizeof(CookedTextureLevel);
+    for (auto &level : level_headers)
+    {
+        level.offset = offset;
+        offset += level.size;
+    }
+
+    std::string output = path + ".ctex";
+    FILE *file = fopen(output.c_str(), "wb");
+    if (!file)
+    {
+        fprintf(stderr, "[%s:%d] Unable to write %s\n", __FILE__, __LINE__, output.c_str());
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(level_headers.data(), sizeof(CookedTextureLevel), level_headers.size(), file);
+    for (auto &level : levels)
+        fwrite(level.data(), 1, level.size(), file);
+    if (fclose(file) != 0)
+    {
+        fprintf(stderr, "[%s:%d] Unable to write %s\n", __FILE__, __LINE__, output.c_str());
+        return false;
+    }
+
+    printf("%s: %dx%d %s, %u levels, %llu bytes (RGBA8 level 0: %zu)\n", output.c_str(), image.width, image.height,
+           alpha ? "BC3" : "BC1", header.level_count, (unsigned long long)offset, image.pixels.size());
+    return true;
+}
+
+static bool is_image_file(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    return ext && (!strcasecmp(ext, ".png") || !strcasecmp(ext, ".jpg") || !strcasecmp(ext, ".jpeg") ||
+                   !strcasecmp(ext, ".tga") || !strcasecmp(ext, ".bmp"));
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <image or directory>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    for (int i = 1; i < argc; i++)
+    {
+        DIR *dir = opendir(argv[i]);
+        if (!dir)
+        {
+            ok = cook(argv[i]) && ok;
+            continue;
+        }
+        while (dirent *entry = readdir(dir))
+            if (entry->d_name[0] != '.' && is_image_file(entry->d_name))
+                ok = cook(std::string(argv[i]) + "/" + entry->d_name) && ok;
+        closedir(dir);
+    }
+    return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,298 @@
+#include <GL/glew.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cooked_texture_format.h"
+
+// Decodes images in job_system jobs and uploads them on the GL thread.
+// load() returns a texture name straight away that shows a 1x1 transparent
+// placeholder; pump() swaps in the real image once its decode finishes,
+// staging it through a pixel buffer object so glTexImage2D doesn't block.
+// When texture_cooker has written an up-to-date <file>.ctex it is mapped
+// and uploaded as-is (compressed, mips included) instead of decoding.
+struct TextureLoader
+{
+    struct Request
+    {
+        TextureLoader *loader;
+        GLuint texture;
+        std::string file;
+    };
+
+    struct DecodedImage
+    {
+        GLuint texture;
+        std::string file;
+        int width, height, channels;
+        uint8_t *pixels;    // stbi allocated, NULL when decoding failed
+        FileData *cooked;   // validated .ctex contents, used instead of pixels
+    };
+
+    bool started = false;
+    JobCounter decoding;               // decode jobs in flight
+    MPMCQueue<DecodedImage *> decoded; // decode jobs -> GL thread
+    std::atomic<int> pending{0};       // requested but not uploaded yet
+
+    GLuint PBO = 0;
+    bool cooked_supported = false;
+    std::unordered_map<std::string, GLuint> loaded; // file -> texture, for reload_file()
+
+    TextureLoader() { decoded.init(1024); }
+    ~TextureLoader() { stop(); }
+
+    // GL thread
+    void start()
+    {
+        GLint extension_count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+        for (GLint i = 0; i < extension_count && !cooked_supported; i++)
+            cooked_supported = !strcmp((const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i), "GL_EXT_texture_compression_s3tc");
+        job_system.start();
+        started = true;
+    }
+
+    // Waits for the decodes in flight and throws their results away
+    void stop()
+    {
+        while (pending > 0)
+        {
+            DecodedImage *image;
+            while (decoded.pop(image))
+                discard(image);
+            if (!job_system.help())
+                std::this_thread::yield();
+        }
+    }
+
+    static void decode_job(void *data, uint32_t, uint32_t)
+    {
+        auto *request = (Request *)data;
+        request->loader->decode(request->texture, std::move(request->file));
+        delete request;
+    }
+
+    void decode(GLuint texture, std::string texture_file)
+    {
+        PROFILE_ZONE("decode texture");
+        stbi_set_flip_vertically_on_load_thread(true);
+        auto *image = new DecodedImage{.texture = texture, .file = std::move(texture_file)};
+        if (cooked_supported)
+            image->cooked = load_cooked(image->file);
+        FileData file;
+        if (!image->cooked && file.load(image->file.c_str()))
+            image->pixels = stbi_load_from_memory((const stbi_uc *)file.data, (int)file.size,
+                                                  &image->width, &image->height, &image->channels, 0);
+        file.release();
+
+        while (!decoded.push(image))
+            std::this_thread::yield();
+    }
+
+    // The .ctex next to texture_file if it is at least as new as the source and well formed
+    static FileData *load_cooked(const std::string &texture_file)
+    {
+        std::string cooked_file = texture_file + ".ctex";
+        struct stat source_stat = {}, cooked_stat = {};
+        if (stat(cooked_file.c_str(), &cooked_stat) != 0)
+            return nullptr;
+        if (stat(texture_file.c_str(), &source_stat) == 0 && source_stat.st_mtime > cooked_stat.st_mtime)
+        {
+            printf("[%s:%d] Ignoring stale %s\n", __FILE__, __LINE__, cooked_file.c_str());
+            return nullptr;
+        }
+
+        auto *file = new FileData;
+        CookedTextureHeader header = {};
+        bool ok = file->load(cooked_file.c_str()) && file->size >= sizeof(header);
+        if (ok)
+        {
+            memcpy(&header, file->data, sizeof(header));
+            ok = header.magic == COOKED_TEXTURE_MAGIC && header.version == COOKED_TEXTURE_VERSION &&
+                 (header.gl_format == COOKED_FORMAT_BC1 || header.gl_format == COOKED_FORMAT_BC3) &&
+                 header.level_count > 0 && file->size >= sizeof(header) + header.level_count * sizeof(CookedTextureLevel);
+        }
+        // Levels must lie past the tables: upload() offsets them from there
+        size_t levels_start = sizeof(header) + header.level_count * sizeof(CookedTextureLevel);
+        for (uint32_t i = 0; ok && i < header.level_count; i++)
+        {
+            CookedTextureLevel level;
+            memcpy(&level, file->data + sizeof(header) + i * sizeof(level), sizeof(level));
+            ok = level.offset >= levels_start && level.offset <= file->size && level.size <= file->size - level.offset;
+        }
+        if (!ok)
+        {
+            printf("[%s:%d] Not a valid cooked texture: %s\n", __FILE__, __LINE__, cooked_file.c_str());
+            delete file;
+            return nullptr;
+        }
+        return file;
+    }
+
+    // Returns immediately; the texture shows the placeholder until pump() uploads the image
+    GLuint load(const char *texture_file)
+    {
+        if (!started)
+            start();
+
+        GLuint texture_id;
+        glGenTextures(1, &texture_id);
+        gl_state.bind_texture(texture_id);
+
+        // set the texture wrapping/filtering options (on the currently bound texture object)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        const uint8_t placeholder[4] = {0, 0, 0, 0};
+        gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        reload(texture_id, texture_file);
+        loaded[texture_file] = texture_id;
+        return texture_id;
+    }
+
+    // Re-decodes a file previously passed to load(); false if it never was
+    bool reload_file(const std::string &texture_file)
+    {
+        auto it = loaded.find(texture_file);
+        if (it == loaded.end())
+            return false;
+        reload(it->second, texture_file.c_str());
+        return true;
+    }
+
+    // Decode texture_file again into an existing texture
+    void reload(GLuint texture_id, const char *texture_file)
+    {
+        pending++;
+        job_system.run_background({decode_job, new Request{this, texture_id, texture_file}, 0, 1, &decoding});
+    }
+
+    // GL thread, once per frame. Uploads finished images until upload_budget bytes have gone out.
+    void pump(size_t upload_budget = 16 * 1024 * 1024)
+    {
+        size_t uploaded = 0;
+        DecodedImage *image;
+        while (uploaded < upload_budget && decoded.pop(image))
+        {
+            uploaded += image->cooked ? upload_cooked(*image) : upload(*image);
+            discard(image);
+        }
+    }
+
+    void discard(DecodedImage *image)
+    {
+        if (image->pixels)
+            stbi_image_free(image->pixels);
+        delete image->cooked;
+        delete image;
+        pending--;
+    }
+
+    // Blocks until every requested texture has been uploaded
+    void finish()
+    {
+        while (pending > 0)
+        {
+            pump(SIZE_MAX);
+            if (!job_system.help())
+                std::this_thread::yield();
+        }
+    }
+
+    size_t upload(const DecodedImage &image)
+    {
+        PROFILE_ZONE("upload texture");
+        if (!image.pixels)
+        {
+            std::cerr << "Failed to load texture: " << image.file << std::endl;
+            return 0;
+        }
+
+        // Choose the correct format based on channels
+        GLint format;
+        if (image.channels == 1)
+            format = GL_RED;
+        else if (image.channels == 3)
+            format = GL_RGB;
+        else if (image.channels == 4)
+            format = GL_RGBA;
+        else {
+            std::cerr << "Unsupported image format: " << image.file << std::endl;
+            return 0;
+        }
+
+        size_t size = (size_t)image.width * image.height * image.channels;
+        if (!PBO)
+            glGenBuffers(1, &PBO);
+        gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW); // orphan the previous upload
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!dst)
+        {
+            gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return 0;
+        }
+        memcpy(dst, image.pixels, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        gl_state.bind_texture(image.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of RGB images aren't 4-byte aligned
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, (void *)0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // Leave unpacking from client memory working for everyone else
+        gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return size;
+    }
+
+    size_t upload_cooked(const DecodedImage &image)
+    {
+        PROFILE_ZONE("upload cooked texture");
+        const char *data = image.cooked->data;
+        CookedTextureHeader header;
+        memcpy(&header, data, sizeof(header));
+        size_t levels_start = sizeof(header) + header.level_count * sizeof(CookedTextureLevel);
+        size_t size = image.cooked->size - levels_start;
+
+        if (!PBO)
+            glGenBuffers(1, &PBO);
+        gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW); // orphan the previous upload
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!dst)
+        {
+            gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return 0;
+        }
+        memcpy(dst, data + levels_start, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        gl_state.bind_texture(image.texture);
+        for (uint32_t i = 0; i < header.level_count; i++)
+        {
+            CookedTextureLevel level;
+            memcpy(&level, data + sizeof(header) + i * sizeof(level), sizeof(level));
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, header.gl_format, level.width, level.height, 0,
+                                   (GLsizei)level.size, (void *)(level.offset - levels_start));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)header.level_count - 1);
+
+        gl_state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return size;
+    }
+};
+
+TextureLoader texture_loader;
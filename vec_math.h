@@ -0,0 +1,412 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+
+// Small vector/matrix/quaternion library for transforms, header only so the
+// host and the game library can both use it.
+//
+// Matrices are column major with each column stored contiguously, the layout
+// glProgramUniformMatrix*fv takes with transpose = GL_FALSE. mat4 and vec4
+// are 16-byte aligned and use SSE on x86 and NEON on ARM, with a plain C++
+// fallback (also forced by defining VEC_MATH_SCALAR). The batch functions at
+// the bottom are where the throughput is: they keep whole registers busy over
+// arrays instead of one transform at a time, and use AVX when it is enabled.
+
+#if !defined(VEC_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#define VEC_MATH_SSE 1
+#include <immintrin.h>
+#elif !defined(VEC_MATH_SCALAR) && defined(__ARM_NEON)
+#define VEC_MATH_NEON 1
+#include <arm_neon.h>
+#endif
+
+struct vec2
+{
+    float x, y;
+};
+
+struct vec3
+{
+    float x, y, z;
+};
+
+struct alignas(16) vec4
+{
+    float x, y, z, w;
+};
+
+struct mat3
+{
+    vec3 columns[3];
+};
+
+struct alignas(16) mat4
+{
+    vec4 columns[4];
+};
+
+struct quat
+{
+    float x, y, z, w; // w is the real part
+};
+
+//--------[ vec2 / vec3 ]----------------------------------------
+// Too narrow to gain from SIMD one at a time; see the batch functions
+
+inline vec2 operator+(vec2 a, vec2 b) { return {a.x + b.x, a.y + b.y}; }
+inline vec2 operator-(vec2 a, vec2 b) { return {a.x - b.x, a.y - b.y}; }
+inline vec2 operator*(vec2 a, float s) { return {a.x * s, a.y * s}; }
+inline float dot(vec2 a, vec2 b) { return a.x * b.x + a.y * b.y; }
+inline float length(vec2 a) { return sqrtf(dot(a, a)); }
+
+inline vec3 operator+(vec3 a, vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline vec3 operator-(vec3 a, vec3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline vec3 operator*(vec3 a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+inline float dot(vec3 a, vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float length(vec3 a) { return sqrtf(dot(a, a)); }
+inline vec3 cross(vec3 a, vec3 b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+
+inline vec3 normalize(vec3 a)
+{
+    float len = length(a);
+    return len > 0 ? a * (1.0f / len) : a;
+}
+
+//--------[ vec4 ]-----------------------------------------------
+
+inline vec4 operator+(const vec4 &a, const vec4 &b)
+{
+    vec4 r;
+#if VEC_MATH_SSE
+    _mm_store_ps(&r.x, _mm_add_ps(_mm_load_ps(&a.x), _mm_load_ps(&b.x)));
+#elif VEC_MATH_NEON
+    vst1q_f32(&r.x, vaddq_f32(vld1q_f32(&a.x), vld1q_f32(&b.x)));
+#else
+    r = {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+#endif
+    return r;
+}
+
+inline vec4 operator-(const vec4 &a, const vec4 &b)
+{
+    vec4 r;
+#if VEC_MATH_SSE
+    _mm_store_ps(&r.x, _mm_sub_ps(_mm_load_ps(&a.x), _mm_load_ps(&b.x)));
+#elif VEC_MATH_NEON
+    vst1q_f32(&r.x, vsubq_f32(vld1q_f32(&a.x), vld1q_f32(&b.x)));
+#else
+    r = {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+#endif
+    return r;
+}
+
+inline vec4 operator*(const vec4 &a, float s)
+{
+    vec4 r;
+#if VEC_MATH_SSE
+    _mm_store_ps(&r.x, _mm_mul_ps(_mm_load_ps(&a.x), _mm_set1_ps(s)));
+#elif VEC_MATH_NEON
+    vst1q_f32(&r.x, vmulq_n_f32(vld1q_f32(&a.x), s));
+#else
+    r = {a.x * s, a.y * s, a.z * s, a.w * s};
+#endif
+    return r;
+}
+
+inline float dot(const vec4 &a, const vec4 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+//--------[ mat3 ]-----------------------------------------------
+
+inline mat3 mat3_identity()
+{
+    return {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}};
+}
+
+inline vec3 operator*(const mat3 &m, vec3 v)
+{
+    return m.columns[0] * v.x + m.columns[1] * v.y + m.columns[2] * v.z;
+}
+
+inline mat3 operator*(const mat3 &a, const mat3 &b)
+{
+    return {{a * b.columns[0], a * b.columns[1], a * b.columns[2]}};
+}
+
+// 2D affine transform for homogeneous vec3(x, y, 1)
+inline mat3 mat3_transform_2d(vec2 translation, float rotation, vec2 scale)
+{
+    float c = cosf(rotation), s = sinf(rotation);
+    return {{{c * scale.x, s * scale.x, 0}, {-s * scale.y, c * scale.y, 0}, {translation.x, translation.y, 1}}};
+}
+
+//--------[ mat4 ]-----------------------------------------------
+
+inline mat4 mat4_identity()
+{
+    return {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+}
+
+inline vec4 operator*(const mat4 &m, const vec4 &v)
+{
+    vec4 r;
+#if VEC_MATH_SSE
+    __m128 sum = _mm_mul_ps(_mm_load_ps(&m.columns[0].x), _mm_set1_ps(v.x));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&m.columns[1].x), _mm_set1_ps(v.y)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&m.columns[2].x), _mm_set1_ps(v.z)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&m.columns[3].x), _mm_set1_ps(v.w)));
+    _mm_store_ps(&r.x, sum);
+#elif VEC_MATH_NEON
+    float32x4_t sum = vmulq_n_f32(vld1q_f32(&m.columns[0].x), v.x);
+    sum = vmlaq_n_f32(sum, vld1q_f32(&m.columns[1].x), v.y);
+    sum = vmlaq_n_f32(sum, vld1q_f32(&m.columns[2].x), v.z);
+    sum = vmlaq_n_f32(sum, vld1q_f32(&m.columns[3].x), v.w);
+    vst1q_f32(&r.x, sum);
+#else
+    r = m.columns[0] * v.x + m.columns[1] * v.y + m.columns[2] * v.z + m.columns[3] * v.w;
+#endif
+    return r;
+}
+
+inline mat4 operator*(const mat4 &a, const mat4 &b)
+{
+    mat4 r;
+    for (int i = 0; i < 4; i++)
+        r.columns[i] = a * b.columns[i];
+    return r;
+}
+
+inline mat4 transpose(const mat4 &m)
+{
+    mat4 r;
+#if VEC_MATH_SSE
+    __m128 c0 = _mm_load_ps(&m.columns[0].x), c1 = _mm_load_ps(&m.columns[1].x);
+    __m128 c2 = _mm_load_ps(&m.columns[2].x), c3 = _mm_load_ps(&m.columns[3].x);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_store_ps(&r.columns[0].x, c0);
+    _mm_store_ps(&r.columns[1].x, c1);
+    _mm_store_ps(&r.columns[2].x, c2);
+    _mm_store_ps(&r.columns[3].x, c3);
+#else
+    const float *src = &m.columns[0].x;
+    float *dst = &r.columns[0].x;
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            dst[i * 4 + j] = src[j * 4 + i];
+#endif
+    return r;
+}
+
+inline mat4 mat4_translate(vec3 t)
+{
+    mat4 r = mat4_identity();
+    r.columns[3] = {t.x, t.y, t.z, 1};
+    return r;
+}
+
+inline mat4 mat4_scale(vec3 s)
+{
+    return {{{s.x, 0, 0, 0}, {0, s.y, 0, 0}, {0, 0, s.z, 0}, {0, 0, 0, 1}}};
+}
+
+// Maps left..right, bottom..top, near..far (distances, like glOrtho) to clip space
+inline mat4 mat4_ortho(float left, float right, float bottom, float top, float near_plane, float far_plane)
+{
+    mat4 r = mat4_identity();
+    r.columns[0].x = 2 / (right - left);
+    r.columns[1].y = 2 / (top - bottom);
+    r.columns[2].z = -2 / (far_plane - near_plane);
+    r.columns[3] = {-(right + left) / (right - left), -(top + bottom) / (top - bottom),
+                    -(far_plane + near_plane) / (far_plane - near_plane), 1};
+    return r;
+}
+
+inline mat4 mat4_perspective(float fov_y, float aspect, float near_plane, float far_plane)
+{
+    float f = 1.0f / tanf(fov_y * 0.5f);
+    mat4 r = {};
+    r.columns[0].x = f / aspect;
+    r.columns[1].y = f;
+    r.columns[2].z = (far_plane + near_plane) / (near_plane - far_plane);
+    r.columns[2].w = -1;
+    r.columns[3].z = 2 * far_plane * near_plane / (near_plane - far_plane);
+    return r;
+}
+
+inline mat3 mat3_from_mat4(const mat4 &m)
+{
+    return {{{m.columns[0].x, m.columns[0].y, m.columns[0].z},
+             {m.columns[1].x, m.columns[1].y, m.columns[1].z},
+             {m.columns[2].x, m.columns[2].y, m.columns[2].z}}};
+}
+
+//--------[ quat ]-----------------------------------------------
+
+inline quat quat_identity()
+{
+    return {0, 0, 0, 1};
+}
+
+// axis must be unit length
+inline quat quat_axis_angle(vec3 axis, float angle)
+{
+    float s = sinf(angle * 0.5f);
+    return {axis.x * s, axis.y * s, axis.z * s, cosf(angle * 0.5f)};
+}
+
+// Rotation b, then a
+inline quat operator*(quat a, quat b)
+{
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+inline quat normalize(quat q)
+{
+    float len = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return len > 0 ? quat{q.x / len, q.y / len, q.z / len, q.w / len} : quat_identity();
+}
+
+inline vec3 rotate(quat q, vec3 v)
+{
+    vec3 u = {q.x, q.y, q.z};
+    vec3 t = cross(u, v) * 2.0f;
+    return v + t * q.w + cross(u, t);
+}
+
+// Shortest-path normalized lerp; close to slerp for the small steps between frames
+inline quat nlerp(quat a, quat b, float t)
+{
+    float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0 ? -1.0f : 1.0f;
+    return normalize(quat{a.x + (b.x * sign - a.x) * t, a.y + (b.y * sign - a.y) * t,
+                      a.z + (b.z * sign - a.z) * t, a.w + (b.w * sign - a.w) * t});
+}
+
+inline mat3 mat3_from_quat(quat q)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return {{{1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy)},
+             {2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx)},
+             {2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy)}}};
+}
+
+// Translation * rotation * scale, the usual model matrix
+inline mat4 mat4_transform(vec3 translation, quat rotation, vec3 scale)
+{
+    mat3 r = mat3_from_quat(rotation);
+    return {{{r.columns[0].x * scale.x, r.columns[0].y * scale.x, r.columns[0].z * scale.x, 0},
+             {r.columns[1].x * scale.y, r.columns[1].y * scale.y, r.columns[1].z * scale.y, 0},
+             {r.columns[2].x * scale.z, r.columns[2].y * scale.z, r.columns[2].z * scale.z, 0},
+             {translation.x, translation.y, translation.z, 1}}};
+}
+
+//--------[ batches ]--------------------------------------------
+
+// out[i] = m * in[i]; in and out may be the same array
+inline void transform_vec4(const mat4 &m, const vec4 *in, vec4 *out, size_t count)
+{
+#if VEC_MATH_SSE
+    __m128 c0 = _mm_load_ps(&m.columns[0].x), c1 = _mm_load_ps(&m.columns[1].x);
+    __m128 c2 = _mm_load_ps(&m.columns[2].x), c3 = _mm_load_ps(&m.columns[3].x);
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128 v = _mm_load_ps(&in[i].x);
+        __m128 sum = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_store_ps(&out[i].x, sum);
+    }
+#elif VEC_MATH_NEON
+    float32x4_t c0 = vld1q_f32(&m.columns[0].x), c1 = vld1q_f32(&m.columns[1].x);
+    float32x4_t c2 = vld1q_f32(&m.columns[2].x), c3 = vld1q_f32(&m.columns[3].x);
+    for (size_t i = 0; i < count; i++)
+    {
+        float32x4_t v = vld1q_f32(&in[i].x);
+        float32x4_t sum = vmulq_lane_f32(c0, vget_low_f32(v), 0);
+        sum = vmlaq_lane_f32(sum, c1, vget_low_f32(v), 1);
+        sum = vmlaq_lane_f32(sum, c2, vget_high_f32(v), 0);
+        sum = vmlaq_lane_f32(sum, c3, vget_high_f32(v), 1);
+        vst1q_f32(&out[i].x, sum);
+    }
+#else
+    for (size_t i = 0; i < count; i++)
+        out[i] = m * in[i];
+#endif
+}
+
+// out[i] = parent * local[i], e.g. a parent transform applied to its children
+inline void multiply_mat4(const mat4 &parent, const mat4 *local, mat4 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        transform_vec4(parent, local[i].columns, out[i].columns, 4);
+}
+
+// out[i] = a[i] * b[i]
+inline void multiply_mat4(const mat4 *a, const mat4 *b, mat4 *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = a[i] * b[i];
+}
+
+// 2D points as separate x and y arrays (see Patrollers) through an affine mat3:
+// eight points per iteration with AVX, four with SSE or NEON. in and out may alias.
+inline void transform_points_2d(const mat3 &m, const float *x, const float *y, float *out_x, float *out_y, size_t count)
+{
+    const float m00 = m.columns[0].x, m01 = m.columns[0].y;
+    const float m10 = m.columns[1].x, m11 = m.columns[1].y;
+    const float tx = m.columns[2].x, ty = m.columns[2].y;
+    size_t i = 0;
+#if VEC_MATH_SSE && defined(__AVX__)
+    {
+        __m256 a = _mm256_set1_ps(m00), b = _mm256_set1_ps(m01), c = _mm256_set1_ps(m10), d = _mm256_set1_ps(m11);
+        __m256 vtx = _mm256_set1_ps(tx), vty = _mm256_set1_ps(ty);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i);
+            __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, px), _mm256_mul_ps(c, py)), vtx);
+            __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b, px), _mm256_mul_ps(d, py)), vty);
+            _mm256_storeu_ps(out_x + i, rx);
+            _mm256_storeu_ps(out_y + i, ry);
+        }
+    }
+#endif
+#if VEC_MATH_SSE
+    {
+        __m128 a = _mm_set1_ps(m00), b = _mm_set1_ps(m01), c = _mm_set1_ps(m10), d = _mm_set1_ps(m11);
+        __m128 vtx = _mm_set1_ps(tx), vty = _mm_set1_ps(ty);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i);
+            __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, px), _mm_mul_ps(c, py)), vtx);
+            __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b, px), _mm_mul_ps(d, py)), vty);
+            _mm_storeu_ps(out_x + i, rx);
+            _mm_storeu_ps(out_y + i, ry);
+        }
+    }
+#elif VEC_MATH_NEON
+    {
+        float32x4_t vtx = vdupq_n_f32(tx), vty = vdupq_n_f32(ty);
+        for (; i + 4 <= count; i += 4)
+        {
+            float32x4_t px = vld1q_f32(x + i), py = vld1q_f32(y + i);
+            float32x4_t rx = vmlaq_n_f32(vmlaq_n_f32(vtx, px, m00), py, m10);
+            float32x4_t ry = vmlaq_n_f32(vmlaq_n_f32(vty, px, m01), py, m11);
+            vst1q_f32(out_x + i, rx);
+            vst1q_f32(out_y + i, ry);
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float px = x[i], py = y[i];
+        out_x[i] = m00 * px + m10 * py + tx;
+        out_y[i] = m01 * px + m11 * py + ty;
+    }
+}
@@ -0,0 +1,117 @@
+#include <GL/glew.h>
+#include <cstdio>
+#include <iostream>
+
+#ifndef HEADLESS_ONLY
+#include <GLFW/glfw3.h>
+#endif
+
+// The GLFW window main draws into when it isn't --headless. Built with
+// -DHEADLESS_ONLY, for GPU-less hosts that have no GLFW to link, there is no
+// window: init() fails and only headless runs work. Everything but init() is
+// a no-op while no window is open.
+struct Window
+{
+#ifndef HEADLESS_ONLY
+    GLFWwindow *window = nullptr;
+
+    static void error_callback(int error, const char *description)
+    {
+        std::cerr << "GLFW Error: " << description << std::endl;
+    }
+
+    bool init(int width, int height, const char *title)
+    {
+        if (!glfwInit())
+        {
+            std::cerr << "Failed to initialize GLFW" << std::endl;
+            return false;
+        }
+        glfwSetErrorCallback(error_callback);
+
+        // Configure GLFW to use OpenGL 4.1
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+        window = glfwCreateWindow(width, height, title, NULL, NULL);
+        if (!window)
+        {
+            std::cerr << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return false;
+        }
+        glfwMakeContextCurrent(window);
+
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK)
+        {
+            std::cerr << "Failed to initialize GLEW" << std::endl;
+            destroy();
+            return false;
+        }
+        return true;
+    }
+
+    void destroy()
+    {
+        if (!window)
+            return;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        window = nullptr;
+    }
+
+    bool open() const
+    {
+        return window != nullptr;
+    }
+
+    bool should_close() const
+    {
+        return window && glfwWindowShouldClose(window);
+    }
+
+    void close()
+    {
+        if (window)
+            glfwSetWindowShouldClose(window, true);
+    }
+
+    bool escape_pressed() const
+    {
+        return window && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS;
+    }
+
+    // Leaves width and height alone when there is no window
+    void framebuffer_size(int *width, int *height) const
+    {
+        if (window)
+            glfwGetFramebufferSize(window, width, height);
+    }
+
+    void swap_buffers()
+    {
+        if (!window)
+            return;
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+#else
+    bool init(int, int, const char *)
+    {
+        printf("[%s:%d] Built without GLFW (HEADLESS_ONLY); run with --headless\n", __FILE__, __LINE__);
+        return false;
+    }
+
+    void destroy() {}
+    bool open() const { return false; }
+    bool should_close() const { return false; }
+    void close() {}
+    bool escape_pressed() const { return false; }
+    void framebuffer_size(int *, int *) const {}
+    void swap_buffers() {}
+#endif
+};